@@ -23,506 +23,600 @@ SOFTWARE.
 */
 
 #include "jsrs.h"
+#include "jsrs_index.h"
+#include "jsrs_number.h"
+#include "jsrs_reader.h"
+#include "jsrs_string.h"
 
-#include <sstream>
 #include <iterator>
-#include <iomanip>
-#include <limits>
 #include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
 
 namespace jstp {
 
-// Record implementation
+// StringRef implementation
 
-Record::Record() : value(std::make_shared<JS_undefined>()) { }
+int StringRef::compare(const StringRef &other) const {
+  const std::size_t common = std::min(length, other.length);
+  int result = common ? std::memcmp(ptr, other.ptr, common) : 0;
+  if (result == 0 && length != other.length) {
+    result = length < other.length ? -1 : 1;
+  }
+  return result;
+}
+// end of StringRef implementation
 
-Record::Record(std::nullptr_t) : value(std::make_shared<JS_null>()) { }
+// FNV-1a
+static std::uint32_t hash_key(StringRef key) {
+  std::uint32_t result = 2166136261u;
+  for (std::size_t i = 0; i < key.size(); ++i) {
+    result = (result ^ static_cast<unsigned char>(key.data()[i])) * 16777619u;
+  }
+  return result;
+}
 
-Record::Record(double val) : value(std::make_shared<JS_number>(val)) { }
+// Hashes of Records, 0 is left for the ones that are not computed yet
 
-Record::Record(bool val) : value(std::make_shared<JS_boolean>(val)) { }
+// FNV-1a of the size of std::size_t
+static std::size_t hash_chars(StringRef chars) {
+  std::uint64_t result = 14695981039346656037ull;
+  for (std::size_t i = 0; i < chars.size(); ++i) {
+    result = (result ^ static_cast<unsigned char>(chars.data()[i])) * 1099511628211ull;
+  }
+  return static_cast<std::size_t>(result);
+}
 
-Record::Record(const string &val) : value(std::make_shared<JS_string>(val)) { }
+static std::size_t hash_combine(std::size_t seed, std::size_t value) {
+  return seed ^ (value + static_cast<std::size_t>(0x9e3779b97f4a7c15ull) + (seed << 6) + (seed >> 2));
+}
 
-Record::Record(const char *value) : value(std::make_shared<JS_string>(value)) { }
+static std::size_t nonzero_hash(std::size_t hash) { return hash ? hash : 1; }
 
-Record::Record(string &&val) : value(std::make_shared<JS_string>(std::move(val))) { }
+// Total order of numbers where NaNs are equal to each other and follow the others
+static int compare_numbers(double lhs, double rhs) {
+  if (lhs < rhs) {
+    return -1;
+  }
+  if (lhs > rhs) {
+    return 1;
+  }
+  if (lhs == rhs) {
+    return 0;
+  }
+  return std::isnan(lhs) ? (std::isnan(rhs) ? 0 : 1) : -1;
+}
 
-Record::Record(const array &values) : value(std::make_shared<JS_array>(values)) { }
+// KeyPool implementation
 
-Record::Record(array &&values) : value(std::make_shared<JS_array>(std::move(values))) { }
+const std::size_t KeyPool::kDefaultMaxKeys;
 
-Record::Record(const object &values) {
-  object_keys keys;
-  for (auto i = values.begin(); i != values.end(); ++i) {
-    keys.push_back(&i->first);
+Key KeyPool::intern(StringRef key) {
+  auto i = keys.find(key);
+  if (i != keys.end()) {
+    return i->second;
+  }
+  if (keys.size() >= max_keys) {
+    return Key(key);
   }
-  value = std::make_shared<JS_object>(values, keys);
+  Key pooled(std::make_shared<const std::string>(key.data(), key.size()));
+  keys.insert(std::make_pair(pooled.ref(), pooled));
+  return pooled;
 }
 
-Record::Record(const object &values, const object_keys &keys) {
-  value = std::make_shared<JS_object>(values, keys);
+KeyPool &KeyPool::local() {
+  static thread_local KeyPool pool;
+  return pool;
+}
+
+std::size_t KeyPool::Hash::operator()(const StringRef &key) const { return hash_key(key); }
+// end of KeyPool implementation
+
+// Empty values
+struct Empty {
+  const std::string string;
+  const Record::array vector;
+  const Record::object map;
+  const Record jsrs;
+  Empty() { }
+};
+
+static const Empty &empty() {
+  static const Empty e;
+  return e;
 }
 
-Record::Record(object &&values) : value(std::make_shared<JS_object>(std::move(values))) { }
+// Record implementation
+
+Record::Record() : tag(UNDEFINED), number(0) { }
+
+Record::Record(std::nullptr_t) : tag(NUL), number(0) { }
 
-Record::Record(object &&values, object_keys &&keys) : value(std::make_shared<JS_object>(std::move(values),
-                                                                                        std::move(keys))) { }
+Record::Record(double val) : tag(NUMBER), number(val) { }
 
-Record::Type Record::type() const {
-  return value->type();
+Record::Record(bool val) : tag(BOOL), number(0) {
+  boolean = val;
 }
 
-bool Record::bool_value() const {
-  return value->bool_value();
+Record::Record(const string &val) : tag(STRING), number(0), value(std::make_shared<JS_string>(val)) { }
+
+Record::Record(const char *value) : tag(STRING), number(0), value(std::make_shared<JS_string>(value)) { }
+
+Record::Record(string &&val) : tag(STRING), number(0), value(std::make_shared<JS_string>(std::move(val))) { }
+
+Record::Record(const char *value, std::size_t length, MemoryResource *memory) : tag(STRING), number(0) {
+  if (memory) {
+    JSTP_CPP_COUNT(count_allocation(length));
+    char *data = static_cast<char *>(memory->allocate(length, 1));
+    std::memcpy(data, value, length);
+    this->value = std::allocate_shared<JS_string_ref>(Allocator<JS_string_ref>(memory), data, length, false, memory);
+  } else {
+    JSTP_CPP_COUNT(count_allocation(sizeof(JS_string) + length));
+    this->value = std::make_shared<JS_string>(string(value, length));
+  }
 }
 
-double Record::number_value() const {
-  return value->number_value();
+Record Record::from_source(const char *value, std::size_t length, bool escaped, MemoryResource *memory,
+                           bool borrow) {
+  if (!escaped && !borrow) {
+    return Record(value, length, memory);
+  }
+  Record result;
+  result.tag = STRING;
+  if (borrow || memory) {
+    const char *data = value;
+    MemoryResource *owner = nullptr;
+    if (!borrow) {
+      JSTP_CPP_COUNT(count_allocation(length));
+      char *copy = static_cast<char *>(memory->allocate(length, 1));
+      std::memcpy(copy, value, length);
+      data = copy;
+      owner = memory;
+    }
+    result.value = std::allocate_shared<JS_string_ref>(Allocator<JS_string_ref>(memory), data, length, escaped,
+                                                       owner);
+  } else {  // Nothing keeps the source, so it is decoded at once
+    string decoded;
+    unescape(value, value + length, decoded);
+    JSTP_CPP_COUNT(count_allocation(sizeof(JS_string) + decoded.size()));
+    result.value = std::make_shared<JS_string>(std::move(decoded));
+  }
+  return result;
 }
 
+Record::Record(const array &values) : tag(ARRAY), number(0), value(std::make_shared<JS_array>(values)) { }
+
+Record::Record(array &&values)
+    : tag(ARRAY), number(0),
+      value(std::allocate_shared<JS_array>(Allocator<JS_array>(values.get_allocator()), std::move(values))) { }
+
+Record::Record(const std::vector<Record> &values)
+    : tag(ARRAY), number(0), value(std::make_shared<JS_array>(array(values.begin(), values.end()))) { }
+
+Record::Record(std::vector<Record> &&values)
+    : tag(ARRAY), number(0), value(std::make_shared<JS_array>(array(std::make_move_iterator(values.begin()),
+                                                                    std::make_move_iterator(values.end())))) { }
+
+Record::Record(const object &values) : tag(OBJECT), number(0), value(std::make_shared<JS_object>(values)) { }
+
+Record::Record(object &&values)
+    : tag(OBJECT), number(0),
+      value(std::allocate_shared<JS_object>(Allocator<JS_object>(values.get_allocator()), std::move(values))) { }
+
+Record::Record(const std::map<string, Record> &values)
+    : tag(OBJECT), number(0), value(std::make_shared<JS_object>(object(values.begin(), values.end()))) { }
+
 const Record::string &Record::string_value() const {
-  return value->string_value();
+  return value ? value->string_value() : empty().string;
 }
 
-const Record::array &Record::array_items() const {
-  return value->array_items();
+StringRef Record::string_ref() const {
+  return value ? value->string_ref() : StringRef();
 }
 
-const Record::object &Record::object_items() const {
-  return value->object_items();
+const Record::array &Record::array_items() const {
+  return value ? value->array_items() : empty().vector;
 }
 
-const Record::object_keys &Record::get_object_keys() const {
-  return value->get_object_keys();
+const Record::object &Record::object_items() const {
+  return value ? value->object_items() : empty().map;
 }
 
 const Record &Record::operator[](std::size_t i) const {
-  return value->operator[](i);
+  return value ? value->operator[](i) : empty().jsrs;
 }
 
 const Record &Record::operator[](const string &key) const {
-  return value->operator[](key);
+  return value ? value->operator[](key) : empty().jsrs;
 }
 
-Record::string Record::stringify() const {
-  string result;
-  value->dump(result);
-  return result;
+Record::array &Record::mutable_array_items() {
+  if (tag == UNDEFINED) {
+    *this = Record(array());
+  } else if (tag != ARRAY) {
+    throw std::domain_error("Record::mutable_array_items");
+  }
+  array *items = value.use_count() == 1 ? value->mutable_array_items() : nullptr;
+  if (!items) {  // Shared or lazy contents
+    *this = Record(array(value->array_items()));
+    items = value->mutable_array_items();
+  }
+  return *items;
 }
 
-bool Record::operator==(const Record &rhs) const {
-  return this->value->equals(rhs.value.get());
+Record::object &Record::mutable_object_items() {
+  if (tag == UNDEFINED) {
+    *this = Record(object());
+  } else if (tag != OBJECT) {
+    throw std::domain_error("Record::mutable_object_items");
+  }
+  object *values = value.use_count() == 1 ? value->mutable_object_items() : nullptr;
+  if (!values) {  // Shared or lazy contents
+    *this = Record(object(value->object_items()));
+    values = value->mutable_object_items();
+  }
+  return *values;
 }
 
-bool Record::operator<(const Record &rhs) const {
-  return this->value->less(rhs.value.get());
+void Record::push_back(Record item) {
+  mutable_array_items().push_back(std::move(item));
 }
 
-bool Record::operator!=(const Record &rhs) const {
-  return !this->value->equals(rhs.value.get());
+void Record::set(Key key, Record val) {
+  mutable_object_items()[std::move(key)] = std::move(val);
 }
 
-bool Record::operator<=(const Record &rhs) const {
-  return this->value->equals(rhs.value.get()) || this->value->less(rhs.value.get());
+bool Record::erase(std::size_t i) {
+  if (i >= array_items().size()) {
+    return false;
+  }
+  array &items = mutable_array_items();
+  items.erase(items.begin() + i);
+  return true;
 }
 
-bool Record::operator>(const Record &rhs) const {
-  return !this->value->equals(rhs.value.get()) && !this->value->less(rhs.value.get());
+bool Record::erase(StringRef key) {
+  if (!object_items().count(key)) {
+    return false;
+  }
+  return mutable_object_items().erase(key) != 0;
 }
 
-bool Record::operator>=(const Record &rhs) const {
-  return this->value->equals(rhs.value.get()) || !this->value->less(rhs.value.get());
+Record::string Record::stringify() const {
+  string result;
+  stringify(result);
+  return result;
 }
 
-const char *prepare_string(const std::string &str) {
-  char *result = new char[str.length() + 1];
-  bool string_mode = false;
-  enum { kDisabled = 0, kOneline, kMultiline } comment_mode = kDisabled;
-  std::size_t j = 0;
-  for (auto i = str.begin(); i != str.end(); ++i) {
-    if ((*i == '\"' || *i == '\'') && (i == str.begin() || *(i - 1) != '\\')) {
-      string_mode = !string_mode;
-    }
-    if (!string_mode) {
-      if (!comment_mode && *i == '/') {
-        switch (*(i + 1)) {
-          case '/':
-            comment_mode = kOneline;
-            break;
-          case '*':
-            comment_mode = kMultiline;
-            break;
-        }
-      }
-      if (!comment_mode && !isspace(*i)) {
-        result[j++] = *i;
-      }
-      if ((comment_mode == kOneline && (*i == '\n' || *i == '\r')) ||
-          (comment_mode == kMultiline && *(i - 1) == '*' && *i == '/')) {
-        comment_mode = kDisabled;
-      }
-    } else {
-      result[j++] = *i;
-    }
-
-  }
-  result[j] = '\0';
-  return result;
+void Record::stringify(string &out) const {
+  JSTP_CPP_TIME(serialize_ns);
+  JSTP_CPP_COUNT(const std::size_t before = out.size());
+  out.reserve(out.size() + size_hint());
+  dump(out);
+  JSTP_CPP_COUNT(pending_stats().bytes_serialized += out.size() - before);
 }
 
-bool get_type(const char *begin, const char *end, Record::Type &type) {
-  bool result = true;
-  switch (*begin) {
-    case ',':
-    case ']':
-      type = Record::Type::UNDEFINED;
-      break;
-    case '{':
-      type = Record::Type::OBJECT;
+void Record::dump(string &out) const {
+  switch (tag) {
+    case UNDEFINED:
+      out += "undefined";
       break;
-    case '[':
-      type = Record::Type::ARRAY;
+    case NUL:
+      out += "null";
       break;
-    case '\"':
-    case '\'':
-      type = Record::Type::STRING;
+    case BOOL:
+      out += boolean ? "true" : "false";
       break;
-    case 't':
-    case 'f':
-      type = Record::Type::BOOL;
-      break;
-    case 'n':
-      type = Record::Type::NUL;
-      if (begin + 4 <= end) {
-        result = (std::strncmp(begin, "null", 4) == 0);
-      }
-      break;
-    case 'u':
-      type = Record::Type::UNDEFINED;
-      if (begin + 9 <= end) {
-        result = (std::strncmp(begin, "undefined", 9) == 0);
-      }
+    case NUMBER: {
+      char buffer[kMaxDoubleLength];
+      out.append(buffer, format_double(number, buffer));
       break;
+    }
     default:
-      result = false;
-      if (isdigit(*begin) || *begin == '.' || *begin == '+' || *begin == '-') {
-        type = Record::Type::NUMBER;
-        result = true;
-      }
+      value->dump(out);
   }
-  return result;
 }
 
-// Parse functions
-Record parse_undefined(const char *begin, const char *end, std::size_t &size, std::string *&err);
-Record parse_null(const char *begin, const char *end, std::size_t &size, std::string *&err);
-Record parse_bool(const char *begin, const char *end, std::size_t &size, std::string *&err);
-Record parse_number(const char *begin, const char *end, std::size_t &size, std::string *&err);
-Record parse_string(const char *begin, const char *end, std::size_t &size, std::string *&err);
-Record parse_array(const char *begin, const char *end, std::size_t &size, std::string *&err);
-Record parse_object(const char *begin, const char *end, std::size_t &size, std::string *&err);
+std::size_t Record::size_hint() const {
+  switch (tag) {
+    case UNDEFINED:
+      return 9;
+    case NUL:
+      return 4;
+    case BOOL:
+      return 5;
+    case NUMBER: {
+      // Integers are the most common, count their digits and assume the longest form for the rest
+      // The range is checked first, converting NaN, infinities or large values to long long is undefined
+      if (!std::isfinite(number) || number > 1e15 || number < -1e15 || number != static_cast<long long>(number)) {
+        return 24;
+      }
+      long long integer = static_cast<long long>(number);
+      std::size_t result = integer < 0 ? 2 : 1;
+      while (integer /= 10) result++;
+      return result;
+    }
+    default:
+      return value->size_hint();
+  }
+}
 
-const std::size_t kMaxKeyLength = 256;
+bool Record::operator==(const Record &rhs) const {
+  if (tag != rhs.tag) {
+    return false;
+  }
+  switch (tag) {
+    case UNDEFINED:
+    case NUL:
+      return true;
+    case BOOL:
+      return boolean == rhs.boolean;
+    case NUMBER:
+      return compare_numbers(number, rhs.number) == 0;  // NaN is equal to NaN, as in compare()
+    default:
+      return value->equals(rhs.value.get());
+  }
+}
 
-Record (*parse_func[])(const char *, const char *, std::size_t &, std::string *&) =
-    {&parse_undefined, &parse_null, &parse_bool, &parse_number, &parse_string, &parse_array, &parse_object};
+bool Record::operator<(const Record &rhs) const {
+  return compare(rhs) < 0;
+}
 
-Record parse_undefined(const char *begin, const char *end, std::size_t &size, std::string *&err) {
-  if (*begin == ',' || *begin == ']') {
-    size = 0;
-  } else if (*begin == 'u') {
-    size = 9;
-  } else {
-    err = new std::string("Invalid format of undefined value");
-  }
-  return Record();
+bool Record::operator!=(const Record &rhs) const {
+  return !(*this == rhs);
 }
 
-Record parse_null(const char *begin, const char *end, std::size_t &size, std::string *&err) {
-  size = 4;
-  return Record(nullptr);
+bool Record::operator<=(const Record &rhs) const {
+  return compare(rhs) <= 0;
 }
 
-Record parse_bool(const char *begin, const char *end, std::size_t &size, std::string *&err) {
-  Record result;
-  if (begin + 4 <= end && strncmp(begin, "true", 4) == 0) {
-    result = Record(true);
-    size = 4;
-  } else if (begin + 5 <= end && strncmp(begin, "false", 5) == 0) {
-    result = Record(false);
-    size = 5;
-  } else {
-    if (!err) {
-      err = new std::string("Invalid format: expected boolean");
-    }
-    result = Record();
-  }
-  return result;
+bool Record::operator>(const Record &rhs) const {
+  return compare(rhs) > 0;
 }
 
-Record parse_number(const char *begin, const char *end, std::size_t &size, std::string *&err) {
-  Record result = Record(atof(begin));
-  size = end - begin;
-  std::size_t i = 0;
-  while (begin[i] != ',' && begin[i] != '}' && begin[i] != ']' && i < size) i++;
-  size = i;
-  return result;
+bool Record::operator>=(const Record &rhs) const {
+  return compare(rhs) >= 0;
 }
 
-Record parse_string(const char *begin, const char *end, std::size_t &size, std::string *&err) {
-  size = end - begin;
-  enum { kApostrophe = 0, kQMarks} string_mode = (*begin == '\'') ? kApostrophe : kQMarks;
-  bool is_ended = false;
-  for (std::size_t i = 1; i < size; ++i) {
-    if ((string_mode == kQMarks && begin[i] == '\"') || (string_mode == kApostrophe && begin[i] == '\'') && begin[i - 1] != '\\') {
-      is_ended = true;
-      size = i - 1;
-      break;
-    }
+int Record::compare(const Record &rhs) const {
+  if (tag != rhs.tag) {
+    return tag < rhs.tag ? -1 : 1;
   }
-  if (!is_ended) {
-    err = new std::string("Error while parsing string");
-  }
-  if (!err) {
-    char *str = new char[size + 1];
-    strncpy(str, begin + 1, size);
-    str[size] = '\0';
-    size += 2;
-    Record result = Record(str);
-    delete[] str;
-    return result;
-  } else {
-    return Record();
+  switch (tag) {
+    case UNDEFINED:
+    case NUL:
+      return 0;
+    case BOOL:
+      return static_cast<int>(boolean) - static_cast<int>(rhs.boolean);
+    case NUMBER:
+      return compare_numbers(number, rhs.number);
+    default:
+      return value == rhs.value ? 0 : value->compare(rhs.value.get());
   }
 }
 
-Record parse_object(const char *begin, const char *end, std::size_t &size, std::string *&err) {
-  bool key_mode = true;
-  size = end - begin;
-  char current_key[kMaxKeyLength];
-  std::size_t current_length = 0;
-  Record::Type current_type;
-  std::map<std::string, Record> object;
-  std::vector<const std::string *> keys;
-  Record t;
-  for (std::size_t i = 1; i < size && !err; ++i) {
-    if (key_mode) {
-      if (begin[i] == ':') {
-        key_mode = false;
-        strncpy(current_key, begin + i - current_length, current_length);
-        current_key[current_length] = '\0';
-        current_length = 0;
-      } else if (isalnum(begin[i]) || begin[i] == '_') {
-        current_length++;
-      } else if (begin[i] == '}') {
-        return Record(std::move(object)); // In case of empty object
-      } else {
-        if (!err) {
-          err = new std::string("Invalid format in object: key is invalid");
-        }
-      }
-    } else {
-      bool valid = get_type(begin + i, end, current_type);
-      if (valid) {
-        t = (parse_func[current_type])(begin + i, end, current_length, err);
-        auto ins = object.insert(std::move(std::make_pair(current_key, std::move(t))));
-        keys.push_back(&ins.first->first);
-        i += current_length;
-        if (begin[i] != ',' && begin[i] != '}') {
-          if (!err) {
-            err = new std::string("Invalid format in object: missed semicolon");
-          }
-        } else if (begin[i] == '}') {
-          size = i + 1;
-          break;
-        }
-        current_key[0] = '\0';
-        current_length = 0;
-        key_mode = true;
-      } else {
-        if (!err) {
-          err = new std::string("Invalid format in object");
-        }
+std::size_t Record::hash() const {
+  switch (tag) {
+    case UNDEFINED:
+    case NUL:
+      return hash_combine(tag, 0);
+    case BOOL:
+      return hash_combine(tag, boolean ? 1 : 0);
+    case NUMBER:
+      if (std::isnan(number)) {  // NaNs with any sign or payload are equal
+        return hash_combine(tag, 1);
       }
-    }
-  }
-  if (err) {
-    return Record();
+      return hash_combine(tag, std::hash<double>()(number == 0 ? 0.0 : number));  // -0 == 0
+    default:
+      return value->hash();
   }
+}
 
-  return Record(std::move(object), std::move(keys));
-}
-
-Record parse_array(const char *begin, const char *end, std::size_t &size, std::string *&err) {
-  Record::Type current_type;
-  std::vector<Record> array;
-  std::size_t current_length = 0;
-  size = end - begin;
-  if (*begin == '[' && *(begin + 1) == ']') { // In case of empty array
-    return Record(std::move(array));
-  }
-  Record t;
-  for (std::size_t i = 1; i < size && !err; ++i) {
-    bool valid = get_type(begin + i, end, current_type);
-    if (valid) {
-      t = (parse_func[current_type])(begin + i, end, current_length, err);
-      array.push_back(std::move(t));
-      i += current_length;
-      current_length = 0;
-      if (begin[i] != ',' && begin[i] != ']') {
-        if (!err) {
-          err = new std::string("Invalid format in array: missed semicolon");
-        }
-      } else if (begin[i] == ']') {
-        size = i + 1;
-        break;
-      }
-    } else {
-      if (!err) {
-        err = new std::string("Invalid format in array");
-      }
-    }
-  }
-  if (err) {
+// Parses in with containers allocated from memory, or from the global heap if it is null,
+// and keys taken from keys if it is given. If borrow is set strings and keys refer to in.
+Record parse_record(const std::string &in, std::string &err, MemoryResource *memory, KeyPool *keys, bool borrow) {
+  RecordBuilder builder(memory, keys, borrow);
+  const char *error = read_record(in.data(), in.data() + in.size(), builder);
+  if (error) {
+    err = error;
     return Record();
   }
-
-  return Record(std::move(array));
+  return builder.result();
 }
-// End of parse functions
 
 Record Record::parse(const string &in, string &err) {
-  const char *to_parse = prepare_string(in);
+  return parse_record(in, err, nullptr, nullptr, false);
+}
+
+Record Record::parse(const string &in, string &err, MemoryResource &memory) {
+  return parse_record(in, err, &memory, nullptr, false);
+}
+
+// Checks the items of one level, nested containers are only matched by brackets
+struct LevelValidator {
+  bool on_undefined() { return true; }
+  bool on_null() { return true; }
+  bool on_bool(bool value) { return true; }
+  bool on_number(double value) { return true; }
+  bool on_string(const char *data, std::size_t length, bool escaped) { return true; }
+  bool on_object_begin() { return true; }
+  bool on_key(StringRef key) { return true; }
+  bool on_object_end() { return true; }
+  bool on_array_begin() { return true; }
+  bool on_array_end() { return true; }
+  bool skip(Record::Type type) { return true; }
+  bool on_skipped(Record::Type type, const char *begin, const char *end) { return true; }
+};
+
+Record Record::parse_lazy(string in, string &err) {
+  std::shared_ptr<const string> source = std::make_shared<const string>(std::move(in));
+  const char *end = source->data() + source->size();
+  const char *begin = skip_spaces(source->data(), end);
   Type type;
-  string *error = nullptr;
-  std::size_t size = strlen(to_parse);
-  if (!get_type(to_parse, to_parse + size, type)) {
+  if (!get_type(begin, end, type)) {
     err = "Invalid type";
     return Record();
   }
-  Record result = (parse_func[type])(to_parse, to_parse + size, size, error);
-  if (size != strlen(to_parse)) {
-    error = new string("Invalid format");
+  if (type != ARRAY && type != OBJECT) {
+    return parse_record(*source, err, nullptr, nullptr, false);
   }
-  delete[] to_parse;
-  if (error) {
-    err = *error;
-    delete error;
+  const char *container_end;
+  LevelValidator validator;
+  Reader<LevelValidator, true> reader(end, validator);
+  {
+    JSTP_CPP_TIME(prepass_ns);
+    container_end = reader.parse_value(begin, type);
   }
-  return result;
+  if (!container_end) {
+    err = reader.get_error();
+    return Record();
+  }
+  if (skip_spaces(container_end, end) != end) {
+    err = "Invalid format";
+    return Record();
+  }
+  return lazy(type, std::move(source), begin, container_end);
 }
 
-// end of Record implementation
-
-// JS_value implementation
+Record Record::lazy(Type kind, std::shared_ptr<const string> source, const char *begin, const char *end) {
+  Record result;
+  result.tag = kind;
+  result.value = std::make_shared<JS_lazy>(kind, std::move(source), begin, end);
+  return result;
+}
 
-// Empty values
-struct Empty {
-  const std::string string;
-  const std::vector<Record> vector;
-  const std::map<std::string, Record> map;
-  const std::vector<const std::string *> keys;
-  const Record jsrs;
-  Empty() { }
-};
+Record Record::parse(const string &in, string &err, KeyPool &keys) {
+  return parse_record(in, err, nullptr, &keys, false);
+}
 
-static const Empty &empty() {
-  static const Empty e;
-  return e;
+Record Record::parse_indexed(const string &in, string &err) {
+  RecordBuilder builder(nullptr, nullptr, false);
+  const char *error = read_indexed(in.data(), in.data() + in.size(), builder);
+  if (error) {
+    err = error;
+    return Record();
+  }
+  return builder.result();
 }
 
-bool Record::JS_value::bool_value() const { return false; }
+// end of Record implementation
 
-double Record::JS_value::number_value() const { return 0.0; }
+// JS_value implementation
 
 const Record::string &Record::JS_value::string_value() const { return empty().string; }
 
+StringRef Record::JS_value::string_ref() const { return StringRef(); }
+
 const Record::array &Record::JS_value::array_items() const { return empty().vector; }
 
 const Record::object &Record::JS_value::object_items() const { return empty().map; }
 
-const Record::object_keys &Record::JS_value::get_object_keys() const { return empty().keys; }
-
 const Record &Record::JS_value::operator[](std::size_t i) const { return empty().jsrs; }
 
 const Record &Record::JS_value::operator[](const std::string &key) const { return empty().jsrs; }
-// end of JS_value implementation
 
-// JS_number implementation
+Record::array *Record::JS_value::mutable_array_items() { return nullptr; }
 
-Record::JS_number::JS_number(double value) : value(value) { }
-
-Record::Type Record::JS_number::type() const { return Record::Type::NUMBER; }
+Record::object *Record::JS_value::mutable_object_items() { return nullptr; }
+// end of JS_value implementation
 
-bool Record::JS_number::equals(const JS_value *other) const {
-  return other->type() == this->type() && this->number_value() == other->number_value();
-}
+// JS_string implementation
 
-bool Record::JS_number::less(const JS_value *other) const {
-  return other->type() == this->type() && this->number_value() < other->number_value();
-}
+Record::JS_string::JS_string(const string &value) : value(value) { }
 
-void Record::JS_number::dump(string &out) const {
-  std::ostringstream result;
-  result << std::setprecision(std::numeric_limits<double>::digits10 + 1) << value;
-  out = result.str();
-}
+Record::JS_string::JS_string(const char *value) : value(value) { }
 
-double Record::JS_number::number_value() const { return value; }
-// end of JS_number implementation
+Record::JS_string::JS_string(string &&value) : value(std::move(value)) { }
 
-// JS_boolean implementation
+Record::Type Record::JS_string::type() const { return Record::Type::STRING; }
 
-Record::JS_boolean::JS_boolean(bool value) : value(value) { }
+bool Record::JS_string::equals(const JS_value *other) const {
+  return other->type() == this->type() && this->string_ref() == other->string_ref();
+}
 
-Record::Type Record::JS_boolean::type() const { return Record::Type::BOOL; }
+int Record::JS_string::compare(const JS_value *other) const {
+  return this->string_ref().compare(other->string_ref());
+}
 
-bool Record::JS_boolean::equals(const JS_value *other) const {
-  return other->type() == this->type() && this->bool_value() == other->bool_value();
+std::size_t Record::JS_string::hash() const {
+  return hash_combine(STRING, hash_chars(string_ref()));
 }
 
-bool Record::JS_boolean::less(const JS_value *other) const {
-  return other->type() == this->type() && this->bool_value() < other->bool_value();
+void Record::JS_string::dump(string &out) const {
+  append_quoted(value.data(), value.size(), out);
 }
 
-void Record::JS_boolean::dump(string &out) const { out = value ? "true" : "false"; }
+std::size_t Record::JS_string::size_hint() const { return value.size() + 2; }
 
-bool Record::JS_boolean::bool_value() const { return value; }
-// end of JS_boolean implementation
+const Record::string &Record::JS_string::string_value() const { return value; }
 
-// JS_string implementation
+StringRef Record::JS_string::string_ref() const { return value; }
+// end of JS_string implementation
 
-Record::JS_string::JS_string(const string &value) : value(value) { }
+// JS_string_ref implementation
 
-Record::JS_string::JS_string(const char *value) : value(value) { }
+Record::JS_string_ref::JS_string_ref(const char *data, std::size_t length, bool escaped, MemoryResource *owner)
+    : data(data), length(length), escaped(escaped), owner(owner), materialized(nullptr) { }
 
-Record::JS_string::JS_string(string &&value) : value(std::move(value)) { }
+Record::JS_string_ref::~JS_string_ref() {
+  delete materialized.load();
+  if (owner) {
+    owner->deallocate(const_cast<char *>(data), length, 1);
+  }
+}
 
-Record::Type Record::JS_string::type() const { return Record::Type::STRING; }
+Record::Type Record::JS_string_ref::type() const { return Record::Type::STRING; }
 
-bool Record::JS_string::equals(const JS_value *other) const {
-  return other->type() == this->type() && this->string_value().compare(other->string_value()) == 0;
+bool Record::JS_string_ref::equals(const JS_value *other) const {
+  return other->type() == this->type() && this->string_ref() == other->string_ref();
 }
 
-bool Record::JS_string::less(const JS_value *other) const {
-  return other->type() == this->type() && this->string_value().compare(other->string_value()) < 0;
+int Record::JS_string_ref::compare(const JS_value *other) const {
+  return this->string_ref().compare(other->string_ref());
 }
 
-void Record::JS_string::dump(string &out) const {
-  std::string result;
-  result += "\"" + value + "\"";
-  out = result;
+std::size_t Record::JS_string_ref::hash() const {
+  return hash_combine(STRING, hash_chars(string_ref()));
 }
 
-const Record::string &Record::JS_string::string_value() const { return value; }
-// end of JS_string implementation
+void Record::JS_string_ref::dump(string &out) const {
+  StringRef characters = string_ref();
+  append_quoted(characters.data(), characters.size(), out);
+}
+
+std::size_t Record::JS_string_ref::size_hint() const { return length + 2; }
+
+const Record::string &Record::JS_string_ref::string_value() const {
+  const string *result = materialized.load(std::memory_order_acquire);
+  if (!result) {
+    string *created = new string();
+    if (escaped) {
+      unescape(data, data + length, *created);
+    } else {
+      created->assign(data, length);
+    }
+    if (materialized.compare_exchange_strong(result, created, std::memory_order_acq_rel)) {
+      result = created;
+    } else { // Another thread was first
+      delete created;
+    }
+  }
+  return *result;
+}
+
+StringRef Record::JS_string_ref::string_ref() const {
+  return escaped ? StringRef(string_value()) : StringRef(data, length);
+}
+// end of JS_string_ref implementation
 
 // JS_array implementation
 
-Record::JS_array::JS_array(const array &values) : values(values) { }
+Record::JS_array::JS_array(const array &values) : values(values), cached_hash(0) { }
 
-Record::JS_array::JS_array(array &&values) : values(std::move(values)) { }
+Record::JS_array::JS_array(array &&values) : values(std::move(values)), cached_hash(0) { }
 
 Record::Type Record::JS_array::type() const { return Record::Type::ARRAY; }
 
@@ -539,57 +633,288 @@ bool Record::JS_array::equals(const JS_value *other) const {
   return result;
 }
 
-bool Record::JS_array::less(const JS_value *other) const {
-  string t, o;
-  this->dump(t);
-  other->dump(o);
-  return other->type() == this->type() && t.compare(o) < 0; // TODO(belochub): Implement better less for arrays
+int Record::JS_array::compare(const JS_value *other) const {
+  const array &others = other->array_items();
+  const std::size_t common = std::min(values.size(), others.size());
+  for (std::size_t i = 0; i < common; ++i) {
+    int result = values[i].compare(others[i]);
+    if (result) {
+      return result;
+    }
+  }
+  return values.size() == others.size() ? 0 : values.size() < others.size() ? -1 : 1;
+}
+
+std::size_t Record::JS_array::hash() const {
+  std::size_t result = cached_hash.load(std::memory_order_relaxed);
+  if (!result) {
+    result = hash_combine(ARRAY, values.size());
+    for (auto i = values.begin(); i != values.end(); ++i) {
+      result = hash_combine(result, i->hash());
+    }
+    result = nonzero_hash(result);
+    cached_hash.store(result, std::memory_order_relaxed);
+  }
+  return result;
 }
 
 void Record::JS_array::dump(string &out) const {
-  std::string result;
-  result += '[';
+  out += '[';
   for (auto i = values.begin(); i != values.end(); ++i) {
     if (i != values.begin()) {
-      result += ',';
+      out += ',';
     }
     if (!i->is_undefined()) {
-      result += i->stringify();
+      i->dump(out);
     }
   }
-  result += ']';
-  out = result;
+  out += ']';
+}
+
+std::size_t Record::JS_array::size_hint() const {
+  std::size_t result = 2 + values.size();
+  for (auto i = values.begin(); i != values.end(); ++i) {
+    result += i->size_hint();
+  }
+  return result;
 }
 
 const Record::array &Record::JS_array::array_items() const { return values; }
 
 const Record &Record::JS_array::operator[](std::size_t i) const { return values[i]; }
+
+Record::array *Record::JS_array::mutable_array_items() {
+  cached_hash.store(0, std::memory_order_relaxed);
+  return &values;
+}
 // end of JS_array implementation
 
-// JS_object implementation
+// OrderedObject implementation
+
+const Record::OrderedObject::size_type Record::OrderedObject::kIndexThreshold;
+
+/**
+ * Open addressing table of entry positions with linear probing, kept at most half full
+ */
+class Record::OrderedObject::Index {
+ public:
+  typedef std::vector<value_type, allocator_type> entries_type;
+
+  explicit Index(const entries_type &entries) : slots(entries.get_allocator()), used(0) {
+    std::size_t capacity = 2 * kIndexThreshold;
+    while (capacity < 2 * entries.size()) {
+      capacity *= 2;
+    }
+    slots.resize(capacity);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      place(hash_key(entries[i].first.ref()), static_cast<std::uint32_t>(i));
+    }
+  }
+
+  // Returns the position of the entry with the key, or the number of entries if there is none
+  std::size_t find(const entries_type &entries, StringRef key, const Key *pooled) const {
+    const std::uint32_t hash = hash_key(key);
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hash & mask; ; i = (i + 1) & mask) {
+      const Slot &slot = slots[i];
+      if (!slot.position) {
+        return entries.size();
+      }
+      const Key &candidate = entries[slot.position - 1].first;
+      if (slot.hash == hash && ((pooled && pooled->same(candidate)) || key == candidate.ref())) {
+        return slot.position - 1;
+      }
+    }
+  }
+
+  // Adds the last of the entries
+  void add(const entries_type &entries) {
+    if (2 * (used + 1) > slots.size()) {
+      grow();
+    }
+    place(hash_key(entries.back().first.ref()), static_cast<std::uint32_t>(entries.size() - 1));
+  }
+
+ private:
+  struct Slot {
+    std::uint32_t hash;
+    std::uint32_t position;  // Position of the entry plus one, zero marks an empty slot
+  };
+
+  void place(std::uint32_t hash, std::uint32_t position) {
+    const std::size_t mask = slots.size() - 1;
+    std::size_t i = hash & mask;
+    while (slots[i].position) {
+      i = (i + 1) & mask;
+    }
+    slots[i].hash = hash;
+    slots[i].position = position + 1;
+    ++used;
+  }
+
+  void grow() {
+    std::vector<Slot, Allocator<Slot>> old(slots.size() * 2, Slot(), slots.get_allocator());
+    old.swap(slots);
+    used = 0;
+    for (auto i = old.begin(); i != old.end(); ++i) {
+      if (i->position) {
+        place(i->hash, i->position - 1);
+      }
+    }
+  }
+
+  std::vector<Slot, Allocator<Slot>> slots;
+  std::size_t used;
+};
+
+Record::OrderedObject::OrderedObject(std::initializer_list<value_type> values, const allocator_type &allocator)
+    : entries(allocator), index(nullptr) {
+  for (auto i = values.begin(); i != values.end(); ++i) {
+    insert(*i);
+  }
+}
 
-Record::JS_object::JS_object(const object &value) : values(value) { }
+Record::OrderedObject::OrderedObject(const OrderedObject &other) : entries(other.entries), index(nullptr) { }
 
-Record::JS_object::JS_object(object &&value) : values(std::move(value)) { }
+Record::OrderedObject::OrderedObject(OrderedObject &&other)
+    : entries(std::move(other.entries)), index(other.index.exchange(nullptr)) { }
 
-Record::JS_object::JS_object(const object &value, const object_keys &keys) {
-  for (auto i = keys.begin(); i != keys.end(); ++i) {
-    auto ins = values.insert(std::make_pair(**i, value.at(**i)));
-    this->keys.push_back(&ins.first->first);
+Record::OrderedObject::~OrderedObject() {
+  drop_index();
+}
+
+Record::OrderedObject &Record::OrderedObject::operator=(const OrderedObject &other) {
+  if (this != &other) {
+    drop_index();
+    entries = other.entries;
+  }
+  return *this;
+}
+
+Record::OrderedObject &Record::OrderedObject::operator=(OrderedObject &&other) {
+  if (this != &other) {
+    drop_index();
+    other.drop_index();
+    entries = std::move(other.entries);
   }
+  return *this;
 }
 
-Record::JS_object::JS_object(object &&value, object_keys &&keys) : values(std::move(value)), keys(std::move(keys)) { }
+Record::OrderedObject::const_iterator Record::OrderedObject::find(StringRef key) const {
+  return entries.begin() + find_position(key);
+}
+
+const Record &Record::OrderedObject::at(StringRef key) const {
+  std::size_t position = find_position(key);
+  if (position == entries.size()) {
+    throw std::out_of_range("Record::OrderedObject::at");
+  }
+  return entries[position].second;
+}
+
+Record &Record::OrderedObject::operator[](Key key) {
+  std::size_t position = find_position(key.ref(), &key);
+  if (position == entries.size()) {
+    entries.emplace_back(std::move(key), Record());
+    appended();
+  }
+  return entries[position].second;
+}
+
+std::pair<Record::OrderedObject::const_iterator, bool> Record::OrderedObject::insert(const value_type &value) {
+  std::size_t position = find_position(value.first.ref(), &value.first);
+  if (position != entries.size()) {
+    return std::make_pair(begin() + position, false);
+  }
+  entries.push_back(value);
+  appended();
+  return std::make_pair(end() - 1, true);
+}
+
+std::pair<Record::OrderedObject::const_iterator, bool> Record::OrderedObject::insert(value_type &&value) {
+  std::size_t position = find_position(value.first.ref(), &value.first);
+  if (position != entries.size()) {
+    return std::make_pair(begin() + position, false);
+  }
+  entries.push_back(std::move(value));
+  appended();
+  return std::make_pair(end() - 1, true);
+}
+
+Record::OrderedObject::size_type Record::OrderedObject::erase(StringRef key) {
+  std::size_t position = find_position(key);
+  if (position == entries.size()) {
+    return 0;
+  }
+  drop_index();  // Positions of the following entries change
+  entries.erase(entries.begin() + position);
+  return 1;
+}
+
+void Record::OrderedObject::clear() {
+  drop_index();
+  entries.clear();
+}
+
+std::size_t Record::OrderedObject::find_position(StringRef key, const Key *pooled) const {
+  const Index *current = get_index();
+  if (current) {
+    return current->find(entries, key, pooled);
+  }
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    if ((pooled && pooled->same(entries[i].first)) || key == entries[i].first.ref()) {
+      return i;
+    }
+  }
+  return entries.size();
+}
+
+const Record::OrderedObject::Index *Record::OrderedObject::get_index() const {
+  Index *current = index.load(std::memory_order_acquire);
+  if (!current && entries.size() >= kIndexThreshold) {
+    Allocator<Index> allocator(entries.get_allocator());
+    Index *built = new (allocator.allocate(1)) Index(entries);
+    if (index.compare_exchange_strong(current, built, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      current = built;
+    } else {  // Another thread has published its index first
+      built->~Index();
+      allocator.deallocate(built, 1);
+    }
+  }
+  return current;
+}
+
+void Record::OrderedObject::appended() {
+  Index *current = index.load(std::memory_order_relaxed);
+  if (current) {
+    current->add(entries);
+  }
+}
+
+void Record::OrderedObject::drop_index() {
+  Index *current = index.exchange(nullptr, std::memory_order_relaxed);
+  if (current) {
+    current->~Index();
+    Allocator<Index>(entries.get_allocator()).deallocate(current, 1);
+  }
+}
+// end of OrderedObject implementation
+
+// JS_object implementation
+
+Record::JS_object::JS_object(const object &value) : values(value), cached_hash(0) { }
+
+Record::JS_object::JS_object(object &&value) : values(std::move(value)), cached_hash(0) { }
 
 Record::Type Record::JS_object::type() const { return Record::Type::OBJECT; }
 
 bool Record::JS_object::equals(const JS_value *other) const {
-  bool result = other->type() == this->type() && this->object_items().size() == other->object_items().size();
+  bool result = other->type() == this->type() && values.size() == other->object_items().size();
   if (result) {
-    auto i = this->object_items().begin();
-    auto j = other->object_items().begin();
-    for (; i != this->object_items().end(); ++i, ++j) {
-      if (i->first != j->first || i->second != j->second) {
+    const object &others = other->object_items();
+    for (auto i = values.begin(); i != values.end(); ++i) {
+      auto j = others.find(i->first.ref());
+      if (j == others.end() || i->second != j->second) {
         result = false;
         break;
       }
@@ -598,62 +923,170 @@ bool Record::JS_object::equals(const JS_value *other) const {
   return result;
 }
 
-bool Record::JS_object::less(const JS_value *other) const {
-  string t, o;
-  this->dump(t);
-  other->dump(o);
-  return other->type() == this->type() && t.compare(o) < 0; // TODO(belochub): Implement better less for objects
+// Writes the positions of the entries of values in the order of their keys to order
+static void sort_by_key(const Record::object &values, std::vector<std::size_t> &order) {
+  order.resize(values.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  Record::object::const_iterator entries = values.begin();
+  std::sort(order.begin(), order.end(), [entries](std::size_t lhs, std::size_t rhs) {
+    return entries[lhs].first < entries[rhs].first;
+  });
+}
+
+int Record::JS_object::compare(const JS_value *other) const {
+  const object &others = other->object_items();
+  if (values.size() != others.size()) {
+    return values.size() < others.size() ? -1 : 1;
+  }
+  const object::const_iterator lhs = values.begin();
+  const object::const_iterator rhs = others.begin();
+  bool same_keys = true;
+  for (std::size_t i = 0; i < values.size() && same_keys; ++i) {
+    same_keys = lhs[i].first.same(rhs[i].first) || lhs[i].first.ref() == rhs[i].first.ref();
+  }
+  std::vector<std::size_t> lhs_order;
+  sort_by_key(values, lhs_order);
+  if (same_keys) {  // Objects of one shape, one order serves both of them
+    for (auto i = lhs_order.begin(); i != lhs_order.end(); ++i) {
+      int result = lhs[*i].second.compare(rhs[*i].second);
+      if (result) {
+        return result;
+      }
+    }
+    return 0;
+  }
+  std::vector<std::size_t> rhs_order;
+  sort_by_key(others, rhs_order);
+  for (std::size_t i = 0; i < lhs_order.size(); ++i) {
+    const object::value_type &left = lhs[lhs_order[i]];
+    const object::value_type &right = rhs[rhs_order[i]];
+    int result = left.first.ref().compare(right.first.ref());
+    if (!result) {
+      result = left.second.compare(right.second);
+    }
+    if (result) {
+      return result;
+    }
+  }
+  return 0;
+}
+
+std::size_t Record::JS_object::hash() const {
+  std::size_t result = cached_hash.load(std::memory_order_relaxed);
+  if (!result) {
+    std::size_t entries = 0;  // A sum does not depend on the order
+    for (auto i = values.begin(); i != values.end(); ++i) {
+      entries += hash_combine(hash_chars(i->first.ref()), i->second.hash());
+    }
+    result = nonzero_hash(hash_combine(hash_combine(OBJECT, values.size()), entries));
+    cached_hash.store(result, std::memory_order_relaxed);
+  }
+  return result;
 }
 
 void Record::JS_object::dump(string &out) const {
-  std::string result;
-  result += '{';
-  for (auto i = keys.begin(); i != keys.end(); ++i) {
-    if (i != keys.begin()) {
-      result += ',';
+  out += '{';
+  for (auto i = values.begin(); i != values.end(); ++i) {
+    if (i != values.begin()) {
+      out += ',';
     }
-    result += **i + ':' + values.at(**i).stringify();
+    StringRef key = i->first.ref();
+    out.append(key.data(), key.size());
+    out += ':';
+    i->second.dump(out);
   }
-  result += '}';
-  out = result;
+  out += '}';
+}
+
+std::size_t Record::JS_object::size_hint() const {
+  std::size_t result = 2 + 2 * values.size();
+  for (auto i = values.begin(); i != values.end(); ++i) {
+    result += i->first.size() + i->second.size_hint();
+  }
+  return result;
 }
 
 const Record::object &Record::JS_object::object_items() const { return values; }
 
-const Record::object_keys &Record::JS_object::get_object_keys() const { return keys; }
+const Record &Record::JS_object::operator[](const std::string &key) const {
+  auto i = values.find(key);
+  return i != values.end() ? i->second : empty().jsrs;
+}
 
-const Record &Record::JS_object::operator[](const std::string &key) const { return values.at(key); }
+Record::object *Record::JS_object::mutable_object_items() {
+  cached_hash.store(0, std::memory_order_relaxed);
+  return &values;
+}
 // end of JS_object implementation
 
-// JS_undefined implementation
+// JS_lazy implementation
 
-Record::Type Record::JS_undefined::type() const { return Record::Type::UNDEFINED; }
+Record::JS_lazy::JS_lazy(Type kind, std::shared_ptr<const string> source, const char *begin, const char *end)
+    : kind(kind), source(std::move(source)), begin(begin), end(end), materialized(nullptr) { }
 
-bool Record::JS_undefined::equals(const JS_value *other) const {
-  return other->type() == this->type();
-}
+Record::JS_lazy::~JS_lazy() { delete materialized.load(); }
 
-bool Record::JS_undefined::less(const JS_value *other) const {
-  return false;
-}
+Record::Type Record::JS_lazy::type() const { return kind; }
+
+bool Record::JS_lazy::equals(const JS_value *other) const { return get().equals(other); }
+
+int Record::JS_lazy::compare(const JS_value *other) const { return get().compare(other); }
+
+std::size_t Record::JS_lazy::hash() const { return get().hash(); }
 
-void Record::JS_undefined::dump(string &out) const { out = "undefined"; }
-// end of JS_undefined implementation
+void Record::JS_lazy::dump(string &out) const { get().dump(out); }
 
-// JS_null implementation
+std::size_t Record::JS_lazy::size_hint() const { return end - begin; }
 
-Record::Type Record::JS_null::type() const { return Record::Type::NUL; }
+const Record::array &Record::JS_lazy::array_items() const { return get().array_items(); }
 
-bool Record::JS_null::equals(const JS_value *other) const {
-  return other->type() == this->type();
+const Record::object &Record::JS_lazy::object_items() const { return get().object_items(); }
+
+const Record &Record::JS_lazy::operator[](std::size_t i) const { return get()[i]; }
+
+const Record &Record::JS_lazy::operator[](const std::string &key) const { return get()[key]; }
+
+const Record::JS_value &Record::JS_lazy::get() const {
+  const Record *result = materialized.load(std::memory_order_acquire);
+  if (!result) {
+    JSTP_CPP_TIME(parse_ns);
+    JSTP_CPP_COUNT(pending_stats().bytes_parsed += end - begin);
+    RecordBuilder builder(source);
+    Reader<RecordBuilder, true> reader(end, builder);
+    if (!reader.parse_value(begin, kind)) {
+      throw std::domain_error(reader.get_error());
+    }
+    Record *created = new Record(builder.result());
+    if (materialized.compare_exchange_strong(result, created, std::memory_order_acq_rel)) {
+      result = created;
+    } else { // Another thread was first
+      delete created;
+    }
+  }
+  return *result->value;
 }
+// end of JS_lazy implementation
+
+// Document implementation
 
-bool Record::JS_null::less(const JS_value *other) const {
-  return false;
+const Record &Document::parse(const std::string &in, std::string &err) {
+  record = Record::parse(in, err, arena);
+  return record;
 }
 
-void Record::JS_null::dump(string &out) const { out = "null"; }
-// end of JS_null implementation
+const Record &Document::parse(const std::string &in, std::string &err, KeyPool &keys) {
+  record = parse_record(in, err, &arena, &keys, false);
+  return record;
+}
+
+const Record &Document::parse(std::string &&in, std::string &err) {
+  inputs.push_back(std::move(in));
+  record = parse_record(inputs.back(), err, &arena, nullptr, true);
+  return record;
+}
+// end of Document implementation
 }
 
 
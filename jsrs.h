@@ -26,21 +26,147 @@ SOFTWARE.
 #define JSTP_CPP_JSRS_H
 
 #include <string>
+#include <cstring>
 #include <vector>
 #include <map>
+#include <list>
+#include <unordered_map>
+#include <initializer_list>
 #include <memory>
 #include <utility>
+#include <tuple>
+#include <atomic>
+#include <functional>
+
+#include "jsrs_arena.h"
 
 namespace jstp {
 
-class Record {
+/**
+ * Non-owning reference to a sequence of characters
+ */
+class StringRef {
+ public:
+  StringRef() : ptr(nullptr), length(0) { }
+  StringRef(const char *data, std::size_t size) : ptr(data), length(size) { }
+  StringRef(const std::string &str) : ptr(str.data()), length(str.size()) { }
+  StringRef(const char *str) : ptr(str), length(std::strlen(str)) { }
 
-  typedef std::string string;
-  typedef std::vector<Record> array;
-  typedef std::map<std::string, Record> object;
-  typedef std::vector<const string *> object_keys;
+  const char *data() const { return ptr; }
+  std::size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+  std::string str() const { return std::string(ptr, length); }
+
+  int compare(const StringRef &other) const;
+
+  bool operator==(const StringRef &rhs) const { return length == rhs.length && compare(rhs) == 0; }
+  bool operator!=(const StringRef &rhs) const { return !(*this == rhs); }
+  bool operator<(const StringRef &rhs) const { return compare(rhs) < 0; }
+
+ private:
+  const char *ptr;
+  std::size_t length;
+};
+
+/**
+ * Key of an object entry
+ *
+ * Keys taken from a KeyPool share one immutable string, so copying them does not
+ * allocate and equal pooled keys compare by pointer. Borrowed keys refer to characters
+ * owned by somebody else, e.g. by the input of a Document.
+ */
+class Key {
+ public:
+  Key() { }
+  Key(const std::string &value) : own(value) { }
+  Key(std::string &&value) : own(std::move(value)) { }
+  Key(const char *value) : own(value) { }
+  explicit Key(StringRef value) : own(value.data(), value.size()) { }
+  explicit Key(std::shared_ptr<const std::string> value) : shared(std::move(value)), chars(*shared) { }
+
+  /**
+   * Returns a key that refers to value without copying it, value must outlive the key and its copies
+   */
+  static Key borrow(StringRef value) {
+    Key result;
+    result.chars = value;
+    return result;
+  }
+
+  StringRef ref() const { return chars.data() ? chars : StringRef(own); }
+  std::string str() const { return ref().str(); }
+
+  std::size_t size() const { return ref().size(); }
+  bool empty() const { return ref().empty(); }
+
+  /**
+   * Returns true if the key was taken from a KeyPool
+   */
+  bool is_pooled() const { return static_cast<bool>(shared); }
+
+  /**
+   * Returns true if both keys refer to one pooled string
+   */
+  bool same(const Key &other) const { return shared && shared == other.shared; }
+
+ private:
+  std::string own;
+  std::shared_ptr<const std::string> shared;
+  // Characters of a pooled or borrowed key
+  StringRef chars;
+};
+
+inline bool operator==(const Key &lhs, const Key &rhs) { return lhs.same(rhs) || lhs.ref() == rhs.ref(); }
+inline bool operator!=(const Key &lhs, const Key &rhs) { return !(lhs == rhs); }
+inline bool operator<(const Key &lhs, const Key &rhs) { return !lhs.same(rhs) && lhs.ref() < rhs.ref(); }
 
+/**
+ * Table of interned object keys
+ *
+ * Parsers that are given a pool take keys from it, so keys that repeat across messages
+ * are allocated once and shared by all the records. Records may outlive the pool.
+ * A pool is not thread safe, use one per parser or the one of the current thread.
+ */
+class KeyPool {
  public:
+  static const std::size_t kDefaultMaxKeys = 4096;
+
+  /**
+   * Once max_keys distinct keys are pooled, other keys are returned unpooled,
+   * so the pool does not grow without bound on arbitrary input
+   */
+  explicit KeyPool(std::size_t max_keys = kDefaultMaxKeys) : max_keys(max_keys) { }
+
+  Key intern(StringRef key);
+
+  std::size_t size() const { return keys.size(); }
+  void clear() { keys.clear(); }
+
+  /**
+   * Returns the pool of the calling thread
+   */
+  static KeyPool &local();
+
+ private:
+  struct Hash {
+    std::size_t operator()(const StringRef &key) const;
+  };
+
+  // Every StringRef refers to the string of its Key
+  std::unordered_map<StringRef, Key, Hash> keys;
+  const std::size_t max_keys;
+};
+
+class Record {
+
+ public:
+
+  typedef std::string string;
+  // Containers take memory from a MemoryResource when the Record is parsed with one, e.g. into a Document
+  typedef std::vector<Record, Allocator<Record>> array;
+  class OrderedObject;
+  typedef OrderedObject object;
 
   enum Type {
     UNDEFINED = 0, NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT
@@ -55,18 +181,28 @@ class Record {
   Record(const string &val);         // STRING
   Record(const char *value);         // STRING
   Record(string &&val);              // STRING
+  Record(const char *value, std::size_t length, MemoryResource *memory);  // STRING, stored in memory if given
+
+  /**
+   * STRING given by the characters between its quotes in the input. Escape sequences, if there are any,
+   * are decoded on the first access. The characters are referenced if borrow is set and then must
+   * outlive the Record, otherwise they are copied to memory if it is given.
+   */
+  static Record from_source(const char *value, std::size_t length, bool escaped, MemoryResource *memory,
+                            bool borrow);
 
   Record(const array &values);       // ARRAY
   Record(array &&values);            // ARRAY
+  Record(const std::vector<Record> &values);  // ARRAY
+  Record(std::vector<Record> &&values);       // ARRAY
 
   Record(const object &values);      // OBJECT
-  Record(const object &values, const object_keys &keys);      // ORDERED_OBJECT
   Record(object &&values);           // OBJECT
-  Record(object &&values, object_keys &&keys);      // ORDERED_OBJECT
+  Record(const std::map<string, Record> &values);  // OBJECT
 
 
 
-  Type type() const;
+  Type type() const { return tag; }
 
   bool is_undefined() const { return type() == UNDEFINED; };
   bool is_null() const { return type() == NUL; };
@@ -79,27 +215,33 @@ class Record {
   /**
    * Returns the enclosed value if this is a boolean, false otherwise
    */
-  bool bool_value() const;
+  bool bool_value() const { return tag == BOOL && boolean; }
 
   /**
    * Returns the enclosed value if this is a number, 0 otherwise
    */
-  double number_value() const;
+  double number_value() const { return tag == NUMBER ? number : 0.0; }
 
   /**
    * Returns the enclosed value if this is a string, '' otherwise
    */
   const string &string_value() const;
 
+  /**
+   * Returns a reference to the enclosed characters if this is a string, empty reference otherwise.
+   * Unlike string_value() it does not allocate, except for strings with escape sequences which
+   * were not decoded while parsing: those are decoded once on the first access and cached.
+   */
+  StringRef string_ref() const;
+
   /**
    * Return the enclosed std::vector if this is an array, or an empty vector otherwise.
    */
   const array &array_items() const;
   /**
-   * Return the enclosed std::map if this is an object, or an empty map otherwise.
+   * Return the enclosed entries in the order of insertion if this is an object, or an empty object otherwise.
    */
   const object &object_items() const;
-  const object_keys &get_object_keys() const;
 
   /**
    * Return a reference to arr[i] if this is an array, UNDEFINED JSTP otherwise.
@@ -111,16 +253,81 @@ class Record {
    */
   const Record &operator[](const string &key) const;
 
+  /**
+   * Return the enclosed std::vector for changing it in place. An UNDEFINED record becomes an empty array first,
+   * other types throw std::domain_error. Contents shared with other Records are copied before, so they
+   * keep seeing the old ones.
+   */
+  array &mutable_array_items();
+  /**
+   * Return the enclosed entries for changing them in place, converting and copying them like mutable_array_items()
+   */
+  object &mutable_object_items();
+
+  /**
+   * Append an item to an array
+   */
+  void push_back(Record item);
+  template <class... Args>
+  Record &emplace_back(Args &&... args);
+
+  /**
+   * Set the value of key in an object, appending the key if there is none
+   */
+  void set(Key key, Record value);
+  /**
+   * Append an entry to an object unless key is present, return true if it was appended
+   */
+  template <class... Args>
+  bool emplace(Key key, Args &&... args);
+
+  /**
+   * Remove the item at i from an array or the entry with key from an object, return true if there was one
+   */
+  bool erase(std::size_t i);
+  bool erase(StringRef key);
+
   /**
    * Serializator
    */
   string stringify() const;
 
+  /**
+   * Appends the serialized record to out, so one buffer may be reused for many records
+   */
+  void stringify(string &out) const;
+
   /*
    * Parser of a Record Serialization
    */
   static Record parse(const string &in, string &err);
 
+  /*
+   * Parser that takes memory for strings, containers and their nodes from memory, e.g. an Arena
+   * or a PoolResource, the result must not outlive it. Keys longer than the small string buffer
+   * of std::string and decoded escape sequences still come from the global heap.
+   */
+  static Record parse(const string &in, string &err, MemoryResource &memory);
+
+  /*
+   * Lazy parser that checks the items of the outermost container and that brackets of in are
+   * balanced. Arrays and objects are parsed one level at a time on the first access to their items,
+   * nested ones are skipped by brackets until they are accessed in turn. Malformed contents found
+   * then throw std::domain_error on every access. The records keep in alive.
+   */
+  static Record parse_lazy(string in, string &err);
+
+  /*
+   * Parser that takes keys of objects from keys
+   */
+  static Record parse(const string &in, string &err, KeyPool &keys);
+
+  /*
+   * Two-stage parser for large inputs: the first stage indexes all brackets, separators and strings
+   * of in, the second one builds the Record walking the index. The results are the ones of parse().
+   */
+  static Record parse_indexed(const string &in, string &err);
+
   bool operator==(const Record &rhs) const;
   bool operator<(const Record &rhs) const;
   bool operator!=(const Record &rhs) const;
@@ -128,6 +335,22 @@ class Record {
   bool operator>(const Record &rhs) const;
   bool operator>=(const Record &rhs) const;
 
+  /**
+   * Three-way structural comparison, returns a negative number, zero or a positive one if this record
+   * is less than, equal to or greater than rhs. Records of different types are ordered by type, NaN follows
+   * the other numbers, arrays are compared item by item and objects by their number of entries and then
+   * by the entries sorted by key. Stops at the first difference. Agrees with operator==: NaN is equal
+   * to NaN and -0 to 0, so NaN keys are found in both ordered and hashed containers.
+   */
+  int compare(const Record &rhs) const;
+
+  /**
+   * Structural hash, equal records have equal ones, all NaNs and both zeros included. The hashes
+   * of arrays and objects are cached in their nodes, references returned by mutable_array_items()
+   * and mutable_object_items() must not be used to change them after that.
+   */
+  std::size_t hash() const;
+
 
  private:
 
@@ -141,72 +364,93 @@ class Record {
     virtual Type type() const = 0;
 
     virtual bool equals(const JS_value *other) const = 0;
-    virtual bool less(const JS_value *other) const = 0;
+    virtual int compare(const JS_value *other) const = 0;
+    virtual std::size_t hash() const = 0;
 
+    // Appends serialized value to out
     virtual void dump(string &out) const = 0;
-    virtual bool bool_value() const;
-    virtual double number_value() const;
+    // Cheap estimate of the serialized length
+    virtual std::size_t size_hint() const = 0;
     virtual const string &string_value() const;
+    virtual StringRef string_ref() const;
     virtual const array &array_items() const;
     virtual const object &object_items() const;
-    virtual const object_keys &get_object_keys() const;
 
     virtual const Record &operator[](std::size_t i) const;
     virtual const Record &operator[](const std::string &key) const;
 
+    // Contents of a container that may be changed in place, nullptr for the other values
+    virtual array *mutable_array_items();
+    virtual object *mutable_object_items();
+
     virtual ~JS_value() { }
   };
 
-  std::shared_ptr<JS_value> value;
-
-  class JS_number: public JS_value {
-   public:
-    JS_number(double value);
-
-    Type type() const;
+  friend class RecordBuilder;
 
-    bool equals(const JS_value *other) const;
-    bool less(const JS_value *other) const;
+  void dump(string &out) const;
+  std::size_t size_hint() const;
 
-    void dump(string &out) const;
+  // Array or object which source is parsed on the first access
+  static Record lazy(Type kind, std::shared_ptr<const string> source, const char *begin, const char *end);
 
-    double number_value() const;
-   private:
-    const double value;
+  Type tag;
+  // Scalars are stored inline, only strings and containers are kept in shared nodes
+  union {
+    bool boolean;
+    double number;
   };
+  std::shared_ptr<JS_value> value;
 
-  class JS_boolean: public JS_value {
+  class JS_string: public JS_value {
    public:
-    JS_boolean(bool value);
+    JS_string(const string &value);
+    JS_string(const char *value);
+    JS_string(string &&value);
 
     Type type() const;
 
     bool equals(const JS_value *other) const;
-    bool less(const JS_value *other) const;
+    int compare(const JS_value *other) const;
+    std::size_t hash() const;
 
     void dump(string &out) const;
+    std::size_t size_hint() const;
 
-    bool bool_value() const;
+    const string &string_value() const;
+    StringRef string_ref() const;
    private:
-    const bool value;
+    const string value;
   };
 
-  class JS_string: public JS_value {
+  /**
+   * String which characters are owned by somebody else, e.g. by a MemoryResource or by the input
+   * of a Document. Escape sequences in them are decoded on the first call of string_value()
+   * or string_ref(). The characters are returned to owner on destruction if it is given.
+   */
+  class JS_string_ref: public JS_value {
    public:
-    JS_string(const string &value);
-    JS_string(const char *value);
-    JS_string(string &&value);
+    JS_string_ref(const char *data, std::size_t length, bool escaped, MemoryResource *owner = nullptr);
+    ~JS_string_ref();
 
     Type type() const;
 
     bool equals(const JS_value *other) const;
-    bool less(const JS_value *other) const;
+    int compare(const JS_value *other) const;
+    std::size_t hash() const;
 
     void dump(string &out) const;
+    std::size_t size_hint() const;
 
     const string &string_value() const;
+    StringRef string_ref() const;
    private:
-    const string value;
+    const char *const data;
+    const std::size_t length;
+    const bool escaped;
+    MemoryResource *const owner;
+    // Built on the first call of string_value()
+    mutable std::atomic<const string *> materialized;
   };
 
   class JS_array: public JS_value {
@@ -217,59 +461,242 @@ class Record {
     Type type() const;
 
     bool equals(const JS_value *other) const;
-    bool less(const JS_value *other) const;
+    int compare(const JS_value *other) const;
+    std::size_t hash() const;
 
     void dump(string &out) const;
+    std::size_t size_hint() const;
 
     const array &array_items() const;
     const Record &operator[](std::size_t i) const;
+
+    array *mutable_array_items();
    private:
-    const array values;
+    array values;
+    // 0 until the hash is computed
+    mutable std::atomic<std::size_t> cached_hash;
   };
 
-  class JS_object: public JS_value {
+  class JS_object;
+
+  /**
+   * Array or object that is parsed from its source on the first access,
+   * accesses throw std::domain_error if the source is malformed
+   */
+  class JS_lazy: public JS_value {
    public:
-    JS_object(const object &value);
-    JS_object(object &&value);
-    JS_object(const object &value, const object_keys &keys);
-    JS_object(object &&value, object_keys &&keys);
+    JS_lazy(Type kind, std::shared_ptr<const string> source, const char *begin, const char *end);
+    ~JS_lazy();
 
     Type type() const;
 
     bool equals(const JS_value *other) const;
-    bool less(const JS_value *other) const;
+    int compare(const JS_value *other) const;
+    std::size_t hash() const;
 
     void dump(string &out) const;
+    std::size_t size_hint() const;
 
+    const array &array_items() const;
     const object &object_items() const;
-    const object_keys &get_object_keys() const;
+    const Record &operator[](std::size_t i) const;
     const Record &operator[](const std::string &key) const;
    private:
-    object values;
-    object_keys keys;
+    const JS_value &get() const;
+
+    const Type kind;
+    const std::shared_ptr<const string> source;
+    const char *const begin;
+    const char *const end;
+    // Built on the first access
+    mutable std::atomic<const Record *> materialized;
   };
+};
 
-  class JS_undefined: public JS_value {
-    Type type() const;
+/**
+ * Entries of an object in the order of insertion
+ *
+ * Entries are stored in one flat vector. Objects of less than kIndexThreshold entries
+ * are searched linearly, larger ones build an open addressing hash index on the first lookup.
+ * Like standard containers, const methods may be called concurrently.
+ */
+class Record::OrderedObject {
+ public:
+  typedef std::pair<Key, Record> value_type;
+  typedef Allocator<value_type> allocator_type;
+  typedef std::vector<value_type, allocator_type>::const_iterator const_iterator;
+  typedef const_iterator iterator;
+  typedef std::size_t size_type;
+
+  static const size_type kIndexThreshold = 16;
+
+  OrderedObject() : index(nullptr) { }
+  explicit OrderedObject(const allocator_type &allocator) : entries(allocator), index(nullptr) { }
+  // The first of the entries with equal keys is kept, as in std::map
+  template <class InputIterator>
+  OrderedObject(InputIterator first, InputIterator last, const allocator_type &allocator = allocator_type())
+      : entries(allocator), index(nullptr) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+  OrderedObject(std::initializer_list<value_type> values, const allocator_type &allocator = allocator_type());
+  OrderedObject(const OrderedObject &other);
+  OrderedObject(OrderedObject &&other);
+  ~OrderedObject();
+
+  OrderedObject &operator=(const OrderedObject &other);
+  OrderedObject &operator=(OrderedObject &&other);
+
+  const_iterator begin() const { return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+  size_type size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
 
-    bool equals(const JS_value *other) const;
-    bool less(const JS_value *other) const;
+  /**
+   * Returns the entry with the given key, or end() if there is none
+   */
+  const_iterator find(StringRef key) const;
+  size_type count(StringRef key) const { return find(key) != end() ? 1 : 0; }
 
-    void dump(string &out) const;
-  };
+  /**
+   * Returns the value of the key, throws std::out_of_range if there is none
+   */
+  const Record &at(StringRef key) const;
 
-  class JS_null: public JS_value {
-    Type type() const;
+  /**
+   * Returns the value of the key, appending an UNDEFINED one if there is none
+   */
+  Record &operator[](Key key);
 
-    bool equals(const JS_value *other) const;
-    bool less(const JS_value *other) const;
+  /**
+   * Appends the entry unless its key is already present
+   */
+  std::pair<const_iterator, bool> insert(const value_type &value);
+  std::pair<const_iterator, bool> insert(value_type &&value);
 
-    void dump(string &out) const;
-  };
+  /**
+   * Appends an entry constructing its value from args unless the key is already present
+   */
+  template <class... Args>
+  std::pair<const_iterator, bool> emplace(Key key, Args &&... args) {
+    std::size_t position = find_position(key.ref(), &key);
+    if (position != entries.size()) {
+      return std::make_pair(begin() + position, false);
+    }
+    entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                         std::forward_as_tuple(std::forward<Args>(args)...));
+    appended();
+    return std::make_pair(end() - 1, true);
+  }
 
+  /**
+   * Removes the entry with the key, keeping the order of the others. Returns the number of removed entries.
+   */
+  size_type erase(StringRef key);
+
+  void reserve(size_type n) { entries.reserve(n); }
+  void clear();
+
+  allocator_type get_allocator() const { return entries.get_allocator(); }
+
+ private:
+  class Index;
+
+  // Returns the position of the entry with the key, or size() if there is none;
+  // pooled is compared by pointer first if it is given
+  std::size_t find_position(StringRef key, const Key *pooled = nullptr) const;
+  const Index *get_index() const;
+  // Keeps the index, if there is one, in sync with an entry that was just appended
+  void appended();
+  void drop_index();
+
+  std::vector<value_type, allocator_type> entries;
+  // Built on the first lookup in a large object
+  mutable std::atomic<Index *> index;
+};
+
+class Record::JS_object: public Record::JS_value {
+ public:
+  JS_object(const object &value);
+  JS_object(object &&value);
+
+  Type type() const;
+
+  bool equals(const JS_value *other) const;
+  int compare(const JS_value *other) const;
+  std::size_t hash() const;
+
+  void dump(string &out) const;
+  std::size_t size_hint() const;
+
+  const object &object_items() const;
+  const Record &operator[](const std::string &key) const;
+
+  object *mutable_object_items();
+ private:
+  object values;
+  // 0 until the hash is computed
+  mutable std::atomic<std::size_t> cached_hash;
 };
 
+template <class... Args>
+Record &Record::emplace_back(Args &&... args) {
+  array &items = mutable_array_items();
+  items.emplace_back(std::forward<Args>(args)...);
+  return items.back();
 }
 
+template <class... Args>
+bool Record::emplace(Key key, Args &&... args) {
+  return mutable_object_items().emplace(std::move(key), std::forward<Args>(args)...).second;
+}
+
+/**
+ * Owner of an arena and of a Record parsed into it
+ *
+ * All the memory is released at once when the document is destroyed,
+ * Records taken from the document must not outlive it.
+ */
+class Document {
+ public:
+  Document() { }
+  // Blocks of the arena are taken from upstream, or from the global heap if it is null
+  explicit Document(std::size_t block_size, MemoryResource *upstream = nullptr) : arena(block_size, upstream) { }
+
+  /**
+   * Parses in into the arena and returns the root Record. The memory of previously
+   * parsed records is kept until the document is destroyed.
+   */
+  const Record &parse(const std::string &in, std::string &err);
+  const Record &parse(const std::string &in, std::string &err, KeyPool &keys);
+
+  /**
+   * Parses in without copying it: strings and keys of the result refer to the characters
+   * of in, which is kept by the document
+   */
+  const Record &parse(std::string &&in, std::string &err);
+
+  const Record &root() const { return record; }
+
+  Arena &get_arena() { return arena; }
+
+ private:
+  Arena arena;  // Declared first to be destroyed last
+  // Inputs of zero-copy parses, a list does not move its strings
+  std::list<std::string> inputs;
+  Record record;
+};
+
+}
+
+namespace std {
+
+template <>
+struct hash<jstp::Record> {
+  std::size_t operator()(const jstp::Record &record) const { return record.hash(); }
+};
+
+}
 
 #endif //JSTP_CPP_JSRS_H
@@ -0,0 +1,195 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace jstp {
+
+namespace {
+
+class NewDeleteResource: public MemoryResource {
+ protected:
+  void *do_allocate(std::size_t size, std::size_t alignment) { return ::operator new(size); }
+  void do_deallocate(void *p, std::size_t size, std::size_t alignment) { ::operator delete(p); }
+  bool do_is_equal(const MemoryResource &other) const noexcept {
+    return dynamic_cast<const NewDeleteResource *>(&other) != nullptr;
+  }
+};
+
+std::uintptr_t align_up(std::uintptr_t address, std::size_t alignment) {
+  return (address + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+MemoryResource *new_delete_resource() noexcept {
+  static NewDeleteResource resource;
+  return &resource;
+}
+
+// Arena implementation
+
+Arena::Arena(std::size_t block_size, MemoryResource *upstream)
+    : upstream(upstream), blocks(nullptr), current(nullptr), limit(nullptr), block_size(block_size),
+      allocated(0), reserved(0) { }
+
+Arena::~Arena() {
+  while (blocks) {
+    Block *next = blocks->next;
+    if (upstream) {
+      upstream->deallocate(blocks, sizeof(Block) + blocks->size);
+    } else {
+      ::operator delete(blocks);
+    }
+    blocks = next;
+  }
+}
+
+void *Arena::do_allocate(std::size_t size, std::size_t alignment) {
+  std::uintptr_t address = align_up(reinterpret_cast<std::uintptr_t>(current), alignment);
+  if (!current || address + size > reinterpret_cast<std::uintptr_t>(limit)) {
+    if (size + alignment > block_size / 4) { // Large chunks get a block of their own
+      allocated += size;
+      address = reinterpret_cast<std::uintptr_t>(add_block(size + alignment, false));
+      return reinterpret_cast<void *>(align_up(address, alignment));
+    }
+    current = add_block(block_size, true);
+    limit = current + block_size;
+    address = align_up(reinterpret_cast<std::uintptr_t>(current), alignment);
+  }
+  current = reinterpret_cast<char *>(address + size);
+  allocated += size;
+  return reinterpret_cast<void *>(address);
+}
+
+char *Arena::add_block(std::size_t size, bool make_current) {
+  Block *block = static_cast<Block *>(upstream ? upstream->allocate(sizeof(Block) + size)
+                                               : ::operator new(sizeof(Block) + size));
+  block->size = size;
+  reserved += sizeof(Block) + size;
+  if (blocks && !make_current) { // Keep the current block at the head
+    block->next = blocks->next;
+    blocks->next = block;
+  } else {
+    block->next = blocks;
+    blocks = block;
+  }
+  return reinterpret_cast<char *>(block + 1);
+}
+
+// end of Arena implementation
+
+// PoolResource implementation
+
+const std::size_t PoolResource::kMaxPooledSize;
+const int PoolResource::kSizeClasses;
+
+PoolResource::PoolResource(std::size_t block_size, MemoryResource *upstream)
+    : upstream(upstream), blocks(nullptr), current(nullptr), limit(nullptr),
+      block_size(std::max(block_size, kMaxPooledSize)), reserved(0) {
+  std::fill(free_lists, free_lists + kSizeClasses, nullptr);
+}
+
+PoolResource::~PoolResource() {
+  while (blocks) {
+    Block *next = blocks->next;
+    upstream_deallocate(blocks, sizeof(Block) + blocks->size);
+    blocks = next;
+  }
+}
+
+// Returns the free list of a request, or -1 if it is not pooled
+int PoolResource::size_class(std::size_t size, std::size_t alignment) {
+  if (alignment > alignof(std::max_align_t)) {
+    return -1;
+  }
+  std::size_t chunk = 8;
+  for (int i = 0; i < kSizeClasses; ++i, chunk *= 2) {
+    if (size <= chunk && alignment <= chunk) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void *PoolResource::do_allocate(std::size_t size, std::size_t alignment) {
+  const int index = size_class(size, alignment);
+  if (index < 0) {
+    return upstream ? upstream->allocate(size, alignment) : ::operator new(size);
+  }
+  if (free_lists[index]) {
+    Chunk *chunk = free_lists[index];
+    free_lists[index] = chunk->next;
+    return chunk;
+  }
+  const std::size_t chunk_size = std::size_t(8) << index;
+  std::uintptr_t address = align_up(reinterpret_cast<std::uintptr_t>(current),
+                                    std::min(chunk_size, alignof(std::max_align_t)));
+  if (!current || address + chunk_size > reinterpret_cast<std::uintptr_t>(limit)) {
+    Block *block = static_cast<Block *>(upstream_allocate(sizeof(Block) + block_size));
+    block->size = block_size;
+    block->next = blocks;
+    blocks = block;
+    current = reinterpret_cast<char *>(block + 1);
+    limit = current + block_size;
+    address = reinterpret_cast<std::uintptr_t>(current);
+  }
+  current = reinterpret_cast<char *>(address + chunk_size);
+  return reinterpret_cast<void *>(address);
+}
+
+void PoolResource::do_deallocate(void *p, std::size_t size, std::size_t alignment) {
+  const int index = size_class(size, alignment);
+  if (index < 0) {
+    if (upstream) {
+      upstream->deallocate(p, size, alignment);
+    } else {
+      ::operator delete(p);
+    }
+    return;
+  }
+  Chunk *chunk = static_cast<Chunk *>(p);
+  chunk->next = free_lists[index];
+  free_lists[index] = chunk;
+}
+
+void *PoolResource::upstream_allocate(std::size_t size) {
+  reserved += size;
+  return upstream ? upstream->allocate(size) : ::operator new(size);
+}
+
+void PoolResource::upstream_deallocate(void *p, std::size_t size) {
+  if (upstream) {
+    upstream->deallocate(p, size);
+  } else {
+    ::operator delete(p);
+  }
+}
+
+// end of PoolResource implementation
+
+}
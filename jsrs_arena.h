@@ -0,0 +1,225 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef JSTP_CPP_JSRS_ARENA_H
+#define JSTP_CPP_JSRS_ARENA_H
+
+#include "jsrs_stats.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace jstp {
+
+/**
+ * Source of memory for Records and parsers, modelled after std::pmr::memory_resource
+ *
+ * Implementations override the do_ functions. Memory is returned with the size and the alignment
+ * it was requested with.
+ */
+class MemoryResource {
+ public:
+  virtual ~MemoryResource() { }
+
+  void *allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+    return do_allocate(size, alignment);
+  }
+
+  void deallocate(void *p, std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+    do_deallocate(p, size, alignment);
+  }
+
+  /**
+   * Returns true if memory allocated by one resource may be deallocated by the other
+   */
+  bool is_equal(const MemoryResource &other) const noexcept { return this == &other || do_is_equal(other); }
+
+ protected:
+  virtual void *do_allocate(std::size_t size, std::size_t alignment) = 0;
+  virtual void do_deallocate(void *p, std::size_t size, std::size_t alignment) = 0;
+  virtual bool do_is_equal(const MemoryResource &other) const noexcept { return false; }
+};
+
+/**
+ * Returns the resource that uses the global operator new and operator delete
+ */
+MemoryResource *new_delete_resource() noexcept;
+
+/**
+ * Bump allocator
+ *
+ * Memory is carved out of large blocks and is released all at once when the arena
+ * is destroyed, deallocation of a single chunk does nothing. Blocks are taken from upstream,
+ * or from the global heap if it is null.
+ */
+class Arena: public MemoryResource {
+ public:
+  static const std::size_t kDefaultBlockSize = 64 * 1024;
+
+  explicit Arena(std::size_t block_size = kDefaultBlockSize, MemoryResource *upstream = nullptr);
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /**
+   * Returns the number of bytes handed out by allocate()
+   */
+  std::size_t bytes_allocated() const { return allocated; }
+
+  /**
+   * Returns the number of bytes obtained from upstream
+   */
+  std::size_t bytes_reserved() const { return reserved; }
+
+ protected:
+  void *do_allocate(std::size_t size, std::size_t alignment);
+  void do_deallocate(void *p, std::size_t size, std::size_t alignment) { }
+
+ private:
+  struct Block {
+    Block *next;
+    std::size_t size;
+  };
+
+  char *add_block(std::size_t size, bool make_current);
+
+  MemoryResource *const upstream;
+  Block *blocks;
+  char *current;
+  char *limit;
+  const std::size_t block_size;
+  std::size_t allocated;
+  std::size_t reserved;
+};
+
+/**
+ * Pool of chunks of fixed sizes, which are reused after deallocation
+ *
+ * Requests of up to kMaxPooledSize bytes are rounded up to a power of two and served from the free
+ * list of that size, which is refilled by blocks from upstream, or from the global heap if it is null.
+ * Larger requests go to upstream directly. Blocks are released when the pool is destroyed.
+ * A pool is not thread safe, use one per thread.
+ */
+class PoolResource: public MemoryResource {
+ public:
+  static const std::size_t kMaxPooledSize = 1024;
+  static const std::size_t kDefaultBlockSize = 64 * 1024;
+
+  explicit PoolResource(std::size_t block_size = kDefaultBlockSize, MemoryResource *upstream = nullptr);
+  ~PoolResource();
+
+  PoolResource(const PoolResource &) = delete;
+  PoolResource &operator=(const PoolResource &) = delete;
+
+  /**
+   * Returns the number of bytes obtained from upstream
+   */
+  std::size_t bytes_reserved() const { return reserved; }
+
+ protected:
+  void *do_allocate(std::size_t size, std::size_t alignment);
+  void do_deallocate(void *p, std::size_t size, std::size_t alignment);
+
+ private:
+  // Sizes of the free lists are 8, 16, ..., kMaxPooledSize
+  static const int kSizeClasses = 8;
+
+  struct Chunk {
+    Chunk *next;
+  };
+
+  struct Block {
+    Block *next;
+    std::size_t size;
+  };
+
+  static int size_class(std::size_t size, std::size_t alignment);
+  void *upstream_allocate(std::size_t size);
+  void upstream_deallocate(void *p, std::size_t size);
+
+  MemoryResource *const upstream;
+  Chunk *free_lists[kSizeClasses];
+  Block *blocks;
+  char *current;
+  char *limit;
+  const std::size_t block_size;
+  std::size_t reserved;
+};
+
+/**
+ * Standard allocator that takes memory from a MemoryResource, or from the global heap if there is none
+ *
+ * Copies of containers fall back to the global heap, so copying a value out of a resource
+ * does not tie it to the resource.
+ */
+template <class T>
+class Allocator {
+ public:
+  typedef T value_type;
+
+  Allocator() noexcept : memory(nullptr) { }
+  Allocator(MemoryResource *memory) noexcept : memory(memory) { }
+  template <class U>
+  Allocator(const Allocator<U> &other) noexcept : memory(other.resource()) { }
+
+  T *allocate(std::size_t n) {
+    JSTP_CPP_COUNT(count_allocation(n * sizeof(T)));
+    if (memory) {
+      return static_cast<T *>(memory->allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, std::size_t n) noexcept {
+    if (memory) {
+      memory->deallocate(p, n * sizeof(T), alignof(T));
+    } else {
+      ::operator delete(p);
+    }
+  }
+
+  Allocator select_on_container_copy_construction() const { return Allocator(); }
+
+  MemoryResource *resource() const noexcept { return memory; }
+
+ private:
+  MemoryResource *memory;
+};
+
+template <class T, class U>
+bool operator==(const Allocator<T> &lhs, const Allocator<U> &rhs) noexcept {
+  return lhs.resource() == rhs.resource() ||
+         (lhs.resource() && rhs.resource() && lhs.resource()->is_equal(*rhs.resource()));
+}
+
+template <class T, class U>
+bool operator!=(const Allocator<T> &lhs, const Allocator<U> &rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+}
+
+#endif //JSTP_CPP_JSRS_ARENA_H
@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+
+#include <cstdint>
+
+TEST(jsrs_arena_test, jsrs_arena_test_Allocate) {
+  jstp::Arena arena(1024);
+  for (std::size_t size = 1; size < 2048; size *= 3) {
+    void *chunk = arena.allocate(size, 16);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(chunk) % 16);
+    memset(chunk, 0, size);
+  }
+  EXPECT_EQ(1 + 3 + 9 + 27 + 81 + 243 + 729, arena.bytes_allocated());
+  EXPECT_GE(arena.bytes_reserved(), arena.bytes_allocated());
+}
+
+TEST(jsrs_arena_test, jsrs_arena_test_Document) {
+  std::vector<std::string> arr = testData::validArray();
+  for (auto &iterator : arr) {
+    std::string err = "";
+    jstp::Record expected = jstp::Record::parse(iterator, err);
+    jstp::Document document;
+    const jstp::Record &jsrs = document.parse(iterator, err);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(expected, jsrs);
+    EXPECT_EQ(expected.stringify(), jsrs.stringify());
+  }
+}
+
+TEST(jsrs_arena_test, jsrs_arena_test_Strings) {
+  std::string err = "";
+  jstp::Document document;
+  const jstp::Record &jsrs = document.parse("{name:'Marcus', list:['Aurelius']}", err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ(jstp::StringRef("Marcus"), jsrs["name"].string_ref());
+  EXPECT_EQ("Aurelius", jsrs["list"][0].string_value());
+  EXPECT_EQ(jstp::Record("Marcus"), jsrs["name"]);
+  EXPECT_GT(document.get_arena().bytes_allocated(), 0);
+  jstp::Record::array copy = jsrs["list"].array_items();
+  EXPECT_EQ(nullptr, copy.get_allocator().resource());
+}
+
+TEST(jsrs_arena_test, jsrs_arena_test_ZeroCopy) {
+  std::string in = "{text:'" + std::string(100, 'x') + "', escaped:'tab\\there', id:'\\u0041\\x42'}";
+  const char *data = in.data();
+  std::string err = "";
+  jstp::Document document;
+  const jstp::Record &jsrs = document.parse(std::move(in), err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ(data + 7, jsrs["text"].string_ref().data());
+  EXPECT_EQ(data + 1, jsrs.object_items().begin()->first.ref().data());
+  EXPECT_EQ(std::string(100, 'x'), jsrs["text"].string_value());
+  EXPECT_EQ("tab\there", jsrs["escaped"].string_value());
+  EXPECT_EQ(jstp::Record("AB"), jsrs["id"]);
+  EXPECT_EQ("{text:\"" + std::string(100, 'x') + "\",escaped:\"tab\\there\",id:\"AB\"}", jsrs.stringify());
+}
+
+TEST(jsrs_arena_test, jsrs_arena_test_Pool) {
+  jstp::PoolResource pool(4096);
+  void *small = pool.allocate(24, 8);
+  void *other = pool.allocate(32, 16);
+  EXPECT_NE(small, other);
+  EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(other) % 16);
+  pool.deallocate(small, 24, 8);
+  EXPECT_EQ(small, pool.allocate(30, 8));
+  void *large = pool.allocate(5000);
+  memset(large, 0, 5000);
+  pool.deallocate(large, 5000);
+  EXPECT_GE(pool.bytes_reserved(), 4096u);
+  EXPECT_TRUE(pool.is_equal(pool));
+  EXPECT_FALSE(pool.is_equal(*jstp::new_delete_resource()));
+  EXPECT_TRUE(jstp::new_delete_resource()->is_equal(*jstp::new_delete_resource()));
+}
+
+// Resource that keeps a count of bytes in use and fails above a limit
+class LimitedResource: public jstp::MemoryResource {
+ public:
+  explicit LimitedResource(std::size_t limit) : limit(limit), used(0) { }
+
+  std::size_t limit;
+  std::size_t used;
+
+ protected:
+  void *do_allocate(std::size_t size, std::size_t alignment) {
+    if (used + size > limit) {
+      throw std::bad_alloc();
+    }
+    used += size;
+    return ::operator new(size);
+  }
+
+  void do_deallocate(void *p, std::size_t size, std::size_t alignment) {
+    used -= size;
+    ::operator delete(p);
+  }
+};
+
+TEST(jsrs_arena_test, jsrs_arena_test_Resource) {
+  LimitedResource memory(1 << 20);
+  std::vector<std::string> arr = testData::validArray();
+  for (auto &iterator : arr) {
+    std::string err = "";
+    jstp::Record expected = jstp::Record::parse(iterator, err);
+    {
+      jstp::Record jsrs = jstp::Record::parse(iterator, err, memory);
+      EXPECT_EQ("", err);
+      EXPECT_EQ(expected, jsrs);
+      EXPECT_EQ(expected.stringify(), jsrs.stringify());
+      if (jsrs.type() == jstp::Record::ARRAY) {
+        jstp::Record copy = jsrs;
+        copy.push_back("tail");
+      }
+    }
+    EXPECT_EQ(0u, memory.used);
+  }
+
+  std::string err = "";
+  {
+    jstp::PoolResource pool(4096, &memory);
+    jstp::Record jsrs = jstp::Record::parse("{name:'Marcus\\n', list:['Aurelius', [1, 2]]}", err, pool);
+    EXPECT_EQ("", err);
+    EXPECT_EQ("Marcus\n", jsrs["name"].string_value());
+    EXPECT_LT(0u, memory.used);
+  }
+  EXPECT_EQ(0u, memory.used);
+
+  {
+    jstp::Document document(1024, &memory);
+    document.parse("[1, 'two', {three: 3}]", err);
+    EXPECT_EQ(document.get_arena().bytes_reserved(), memory.used);
+  }
+  EXPECT_EQ(0u, memory.used);
+
+  LimitedResource small(256);
+  EXPECT_THROW(jstp::Record::parse("['" + std::string(1000, 'x') + "']", err, small), std::bad_alloc);
+  EXPECT_EQ(0u, small.used);
+}
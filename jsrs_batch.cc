@@ -0,0 +1,313 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_batch.h"
+#include "jsrs_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace jstp {
+
+static std::size_t default_threads(std::size_t threads) {
+  if (!threads) {
+    threads = std::thread::hardware_concurrency();
+  }
+  return std::max<std::size_t>(threads, 1);
+}
+
+const std::size_t BatchParser::kMinChunkSize;
+
+BatchParser::BatchParser(std::size_t threads)
+    : count(default_threads(threads)), ranges(new Range[count]), generation(0), running(0), stopping(false),
+      task(nullptr) {
+  for (std::size_t i = 0; i < count; ++i) {
+    ranges[i].next = ranges[i].end = 0;
+  }
+  for (std::size_t i = 1; i < count; ++i) {  // The calling thread is the first worker
+    this->threads.emplace_back(&BatchParser::run, this, i);
+  }
+}
+
+BatchParser::~BatchParser() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto i = threads.begin(); i != threads.end(); ++i) {
+    i->join();
+  }
+}
+
+void BatchParser::parse_many(const StringRef *inputs, std::size_t size, std::vector<ParseResult> &results) {
+  results.clear();
+  results.resize(size);
+  ParseResult *outputs = results.data();
+  run_batch(size, [inputs, outputs](std::size_t message, RecordBuilder &builder) {
+    const StringRef &in = inputs[message];
+    const char *error = read_record(in.data(), in.data() + in.size(), builder);
+    if (error) {
+      outputs[message].error = error;
+    } else {
+      outputs[message].record = builder.result();
+    }
+  });
+}
+
+void BatchParser::parse_many(const std::vector<std::string> &inputs, std::vector<ParseResult> &results) {
+  std::vector<StringRef> refs(inputs.begin(), inputs.end());
+  parse_many(refs.data(), refs.size(), results);
+}
+
+void BatchParser::parse_packets(StringRef in, std::vector<ParseResult> &results) {
+  std::vector<StringRef> packets;
+  const char *i = in.data();
+  const char *end = i + in.size();
+  while (i < end) {
+    const char *terminator = static_cast<const char *>(std::memchr(i, '\0', end - i));
+    const char *packet_end = terminator ? terminator : end;
+    packets.push_back(StringRef(i, packet_end - i));
+    i = terminator ? terminator + 1 : end;
+  }
+  parse_many(packets.data(), packets.size(), results);
+}
+
+// Finds the closing bracket of the array that starts at begin, minding strings and comments, and the top level
+// commas that split its items into chunks of at least chunk_size characters. Returns a pointer past the bracket,
+// or nullptr if there is none.
+static const char *split_array(const char *begin, const char *end, std::size_t chunk_size,
+                               std::vector<const char *> &splits) {
+  JSTP_CPP_TIME(prepass_ns);
+  std::size_t depth = 0;
+  const char *next_split = begin + chunk_size;
+  const char *i = begin;
+  while ((i = find_token_stop(i, end)) < end) {
+    switch (*i) {
+      case '{':
+      case '[':
+        ++depth;
+        ++i;
+        break;
+      case '}':
+      case ']':
+        ++i;
+        if (--depth == 0) {
+          return i;
+        }
+        break;
+      case ',':
+        if (depth == 1 && i >= next_split) {
+          splits.push_back(i);
+          next_split = i + chunk_size;
+        }
+        ++i;
+        break;
+      case '\"':
+      case '\'':
+      case '/':
+        i = skip_quoted(i, end);
+        if (!i) {
+          return nullptr;
+        }
+        break;
+      default:
+        ++i;
+    }
+  }
+  return nullptr;
+}
+
+// Parses the items of an array between begin and end, which are separated by commas, into an array.
+// An empty item is a hole, as in an array. Returns nullptr on success or an error message.
+static const char *read_items(const char *begin, const char *end, RecordBuilder &builder) {
+  JSTP_CPP_TIME(parse_ns);
+  JSTP_CPP_COUNT(pending_stats().bytes_parsed += end - begin);
+  Reader<RecordBuilder> reader(end, builder);
+  builder.on_array_begin();
+  const char *i = skip_spaces(begin, end);
+  for (;;) {
+    Record::Type type;
+    if (i == end) {
+      builder.on_undefined();
+    } else if (!get_type(i, end, type)) {
+      return "Invalid format in array";
+    } else if (!(i = reader.parse_value(i, type))) {
+      return reader.get_error();
+    }
+    i = skip_spaces(i, end);
+    if (i == end) {
+      break;
+    }
+    if (*i != ',') {
+      return "Invalid format in array: missed semicolon";
+    }
+    i = skip_spaces(i + 1, end);
+  }
+  builder.on_array_end();
+  return nullptr;
+}
+
+Record BatchParser::parse_array(StringRef in, std::string &err) {
+  const char *end = in.data() + in.size();
+  const char *begin = skip_spaces(in.data(), end);
+  const std::size_t chunk_size = std::max(kMinChunkSize, in.size() / (count * 8));
+  if (count == 1 || begin == end || *begin != '[' || in.size() < 2 * chunk_size) {
+    RecordBuilder builder(nullptr, nullptr, false);
+    const char *error = read_record(in.data(), end, builder);
+    if (error) {
+      err = error;
+      return Record();
+    }
+    return builder.result();
+  }
+  std::vector<const char *> splits;
+  const char *array_end = split_array(begin, end, chunk_size, splits);
+  if (!array_end) {
+    err = "Invalid format in array: missed closing bracket";
+    return Record();
+  }
+  if (skip_spaces(array_end, end) != end) {
+    err = "Invalid format";
+    return Record();
+  }
+  const char *body = begin + 1;
+  const char *body_end = array_end - 1;
+  if (skip_spaces(body, body_end) == body_end) {  // In case of empty array
+    return Record(Record::array());
+  }
+  splits.push_back(body_end);
+  std::vector<ParseResult> chunks(splits.size());
+  ParseResult *outputs = chunks.data();
+  const char *const *bounds = splits.data();
+  run_batch(splits.size(), [body, bounds, outputs](std::size_t chunk, RecordBuilder &builder) {
+    const char *error = read_items(chunk ? bounds[chunk - 1] + 1 : body, bounds[chunk], builder);
+    if (error) {
+      outputs[chunk].error = error;
+    } else {
+      outputs[chunk].record = builder.result();
+    }
+  });
+  std::size_t size = 0;
+  for (auto i = chunks.begin(); i != chunks.end(); ++i) {
+    if (!i->ok()) {
+      err = i->error;
+      return Record();
+    }
+    size += i->record.array_items().size();
+  }
+  Record::array items;
+  items.reserve(size);
+  for (auto i = chunks.begin(); i != chunks.end(); ++i) {
+    Record::array &chunk = i->record.mutable_array_items();
+    std::move(chunk.begin(), chunk.end(), std::back_inserter(items));
+  }
+  return Record(std::move(items));
+}
+
+void BatchParser::run_batch(std::size_t size, const Task &task) {
+  std::lock_guard<std::mutex> guard(batch);
+  if (!size) {
+    return;
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    ranges[i].next = size * i / count;
+    ranges[i].end = size * (i + 1) / count;
+  }
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    this->task = &task;
+    running = count - 1;
+    ++generation;
+  }
+  wake.notify_all();
+  work(0);
+  std::unique_lock<std::mutex> wait(lock);
+  done.wait(wait, [this] { return running == 0; });
+}
+
+void BatchParser::run(std::size_t worker) {
+  std::size_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> wait(lock);
+      wake.wait(wait, [this, seen] { return stopping || generation != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+    }
+    work(worker);
+    std::lock_guard<std::mutex> guard(lock);
+    if (--running == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+void BatchParser::work(std::size_t worker) {
+  RecordBuilder builder(nullptr, &KeyPool::local(), false);
+  std::size_t next;
+  while (take(worker, next) || (steal(worker) && take(worker, next))) {
+    (*task)(next, builder);
+    builder.clear();
+  }
+}
+
+bool BatchParser::take(std::size_t worker, std::size_t &next) {
+  Range &range = ranges[worker];
+  std::lock_guard<std::mutex> guard(range.lock);
+  if (range.next == range.end) {
+    return false;
+  }
+  next = range.next++;
+  return true;
+}
+
+bool BatchParser::steal(std::size_t worker) {
+  for (std::size_t i = 1; i < count; ++i) {
+    Range &victim = ranges[(worker + i) % count];
+    std::size_t begin;
+    std::size_t end;
+    {
+      std::lock_guard<std::mutex> guard(victim.lock);
+      const std::size_t left = victim.end - victim.next;
+      if (!left) {
+        continue;
+      }
+      end = victim.end;
+      victim.end -= (left + 1) / 2;  // The last one left is taken as well
+      begin = victim.end;
+    }
+    Range &own = ranges[worker];
+    std::lock_guard<std::mutex> guard(own.lock);
+    own.next = begin;
+    own.end = end;
+    return true;
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,134 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JSTP_CPP_JSRS_BATCH_H
+#define JSTP_CPP_JSRS_BATCH_H
+
+#include "jsrs.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jstp {
+
+class RecordBuilder;
+
+/**
+ * Record parsed from one message of a batch, error is empty on success
+ */
+struct ParseResult {
+  Record record;
+  std::string error;
+
+  bool ok() const { return error.empty(); }
+};
+
+/**
+ * Pool of threads that parses batches of independent messages
+ *
+ * Messages of a batch are split into equal ranges, one for every thread. A thread that has finished
+ * its range steals half of what is left of the range of another one, so a large message does not
+ * hold back the rest of the batch. The calling thread takes part in the work. Keys of objects are
+ * interned in the KeyPool of the thread that parses them.
+ *
+ * One batch is parsed at a time, concurrent calls wait for each other.
+ */
+class BatchParser {
+ public:
+  /**
+   * Creates a pool of the given number of threads including the calling one,
+   * 0 stands for the number of hardware threads
+   */
+  explicit BatchParser(std::size_t threads = 0);
+  ~BatchParser();
+
+  BatchParser(const BatchParser &) = delete;
+  BatchParser &operator=(const BatchParser &) = delete;
+
+  std::size_t size() const { return count; }
+
+  /**
+   * Parses every input, results go in the order of inputs
+   */
+  void parse_many(const StringRef *inputs, std::size_t size, std::vector<ParseResult> &results);
+  void parse_many(const std::vector<std::string> &inputs, std::vector<ParseResult> &results);
+
+  /**
+   * Parses packets of in that are terminated by '\0'. The characters after the last terminator
+   * are a packet as well unless there are none.
+   */
+  void parse_packets(StringRef in, std::vector<ParseResult> &results);
+
+  /**
+   * Parses in like Record::parse, but a top level array is split into chunks of items at its top level commas,
+   * which are parsed in parallel and joined. Other records are parsed by the calling thread.
+   */
+  Record parse_array(StringRef in, std::string &err);
+
+  // Chunks of a split array are not shorter
+  static const std::size_t kMinChunkSize = 64 * 1024;
+
+ private:
+  // Range of messages that is not taken yet
+  struct Range {
+    std::mutex lock;
+    std::size_t next;
+    std::size_t end;
+  };
+
+  // Every message of a batch is a task, it is given the builder of the thread that runs it
+  typedef std::function<void(std::size_t task, RecordBuilder &builder)> Task;
+
+  // Runs task for every number below size on all threads
+  void run_batch(std::size_t size, const Task &task);
+  void run(std::size_t worker);
+  void work(std::size_t worker);
+  bool take(std::size_t worker, std::size_t &next);
+  bool steal(std::size_t worker);
+
+  const std::size_t count;
+  std::unique_ptr<Range[]> ranges;
+  std::vector<std::thread> threads;
+
+  // Guards the fields of a batch and wakes the threads
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::size_t generation;
+  std::size_t running;
+  bool stopping;
+  const Task *task;
+
+  // Held during a batch
+  std::mutex batch;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_BATCH_H
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_batch.h"
+
+TEST(jsrs_batch_test, jsrs_batch_test_ParseMany) {
+  std::vector<std::string> inputs;
+  for (int i = 0; i < 1000; ++i) {
+    inputs.push_back(i % 100 == 7 ? "{id:" + std::to_string(i) + "," : "{id:" + std::to_string(i) + ",tags:['a']}");
+  }
+  std::string large = "[{x:0}";
+  for (int i = 1; i < 100000; ++i) {
+    large += ",{x:1}";
+  }
+  inputs[3] = large + "]";
+
+  for (std::size_t threads : {1, 4}) {
+    jstp::BatchParser parser(threads);
+    EXPECT_EQ(threads, parser.size());
+    std::vector<jstp::ParseResult> results;
+    parser.parse_many(inputs, results);
+    ASSERT_EQ(inputs.size(), results.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+      if (i == 3) {
+        EXPECT_EQ(100000, results[i].record.array_items().size());
+      } else if (i % 100 == 7) {
+        EXPECT_FALSE(results[i].ok());
+        EXPECT_TRUE(results[i].record.is_undefined());
+      } else {
+        EXPECT_TRUE(results[i].ok()) << results[i].error;
+        EXPECT_EQ(static_cast<double>(i), results[i].record["id"].number_value());
+      }
+    }
+    // The pool is reused by the next batch
+    parser.parse_many(std::vector<std::string>(), results);
+    EXPECT_TRUE(results.empty());
+    parser.parse_many(std::vector<std::string>(inputs.begin(), inputs.begin() + 2), results);
+    ASSERT_EQ(2, results.size());
+    EXPECT_EQ(1, results[1].record["id"].number_value());
+  }
+}
+
+TEST(jsrs_batch_test, jsrs_batch_test_ParsePackets) {
+  jstp::BatchParser parser(3);
+  std::vector<jstp::ParseResult> results;
+  const std::string in("{a:1}\0[2]\0\0'x'", 15);
+  parser.parse_packets(in, results);
+  ASSERT_EQ(4, results.size());
+  EXPECT_EQ("{a:1}", results[0].record.stringify());
+  EXPECT_EQ("[2]", results[1].record.stringify());
+  EXPECT_FALSE(results[2].ok());
+  EXPECT_EQ("\"x\"", results[3].record.stringify());
+
+  parser.parse_packets(std::string("{a:1}\0", 6), results);
+  EXPECT_EQ(1, results.size());
+}
+
+TEST(jsrs_batch_test, jsrs_batch_test_ParseArray) {
+  std::string in = " [";
+  for (int i = 0; i < 20000; ++i) {
+    in += "{id:" + std::to_string(i) + ",text:'a, \\'b\\' [c]', /* , ] */ list:[1,,{x:'}'}]},\n";
+  }
+  in += ",null ] ";
+  std::string err = "";
+  jstp::Record expected = jstp::Record::parse(in, err);
+  ASSERT_EQ("", err);
+  jstp::BatchParser parser(4);
+  jstp::Record record = parser.parse_array(in, err);
+  EXPECT_EQ("", err);
+  ASSERT_EQ(20002, record.array_items().size());
+  EXPECT_EQ(expected, record);
+
+  for (const std::string &iterator : {std::string("[ /* */ ]"), std::string("{a:[1,2]}"), std::string("[1,2],")}) {
+    expected = jstp::Record::parse(iterator, err = "");
+    std::string expected_err = err;
+    EXPECT_EQ(expected, parser.parse_array(iterator, err = ""));
+    EXPECT_EQ(expected_err, err);
+  }
+
+  // Malformed items are found in any chunk
+  std::string broken = in;
+  broken.replace(broken.find("{id:12345,"), 4, "{id ");
+  parser.parse_array(broken, err = "");
+  EXPECT_NE("", err);
+  broken = in.substr(0, in.size() - 3);
+  EXPECT_TRUE(parser.parse_array(broken, err = "").is_undefined());
+  EXPECT_EQ("Invalid format in array: missed closing bracket", err);
+  broken = in + "1";
+  parser.parse_array(broken, err = "");
+  EXPECT_EQ("Invalid format", err);
+}
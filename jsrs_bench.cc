@@ -0,0 +1,155 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Throughput of parsing, serialization, binary encoding, comparison and lookups on generated corpora
+//
+// Usage: jsrs_bench [megabytes per corpus] [repeats]
+// Every measurement is the best of the repeats.
+
+#include "jsrs.h"
+#include "jsrs_binary.h"
+#include "jsrs_corpus.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+namespace {
+
+// Keeps results alive, so the measured work is not optimized out
+std::size_t sink = 0;
+
+double best_seconds(int repeats, const std::function<void()> &run) {
+  double best = 0;
+  for (int i = 0; i < repeats; ++i) {
+    auto begin = std::chrono::steady_clock::now();
+    run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (!i || seconds < best) {
+      best = seconds;
+    }
+  }
+  return best;
+}
+
+void report(const char *shape, const char *operation, std::size_t bytes, std::size_t items, double seconds) {
+  if (bytes) {
+    std::printf("%-10s %-10s %10.1f MB/s %14.0f items/s\n", shape, operation, bytes / seconds / 1e6, items / seconds);
+  } else {
+    std::printf("%-10s %-10s %15s %14.0f items/s\n", shape, operation, "", items / seconds);
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  const std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+  const int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+  std::printf("%-10s %-10s %15s %20s\n", "corpus", "operation", "throughput", "rate");
+
+  for (int i = 0; i < jstp::Corpus::kShapes; ++i) {
+    const jstp::Corpus::Shape shape = static_cast<jstp::Corpus::Shape>(i);
+    const char *name = jstp::Corpus::name(shape);
+    jstp::Corpus corpus;
+    std::size_t count = 0;
+    const std::string in = corpus.generate(shape, megabytes * 1000 * 1000, count);
+
+    std::string err;
+    const jstp::Record record = jstp::Record::parse(in, err);
+    if (!err.empty()) {
+      std::fprintf(stderr, "%s corpus is malformed: %s\n", name, err.c_str());
+      return 1;
+    }
+    const jstp::Record copy = jstp::Record::parse(in, err);
+    const jstp::Record::array &items = record.array_items();
+    const jstp::Record::array &copies = copy.array_items();
+
+    report(name, "parse", in.size(), count, best_seconds(repeats, [&] {
+      sink += jstp::Record::parse(in, err).array_items().size();
+    }));
+
+    report(name, "document", in.size(), count, best_seconds(repeats, [&] {
+      jstp::Document document;
+      sink += document.parse(in, err).array_items().size();
+    }));
+
+    std::string out;
+    double seconds = best_seconds(repeats, [&] {
+      out.clear();
+      record.stringify(out);
+      sink += out.size();
+    });
+    report(name, "stringify", out.size(), count, seconds);
+
+    std::string encoded;
+    seconds = best_seconds(repeats, [&] {
+      encoded.clear();
+      jstp::encode(record, encoded);
+      sink += encoded.size();
+    });
+    report(name, "encode", encoded.size(), count, seconds);
+
+    report(name, "decode", encoded.size(), count, best_seconds(repeats, [&] {
+      sink += jstp::decode(encoded, err).array_items().size();
+    }));
+
+    report(name, "view", encoded.size(), count, best_seconds(repeats, [&] {
+      jstp::BinaryView view = jstp::BinaryView::open(encoded.data(), encoded.size(), err);
+      sink += view[view.size() - 1].type();
+    }));
+
+    report(name, "equals", 0, count, best_seconds(repeats, [&] {
+      for (std::size_t j = 0; j < items.size(); ++j) {
+        sink += items[j] == copies[j];
+      }
+    }));
+
+    report(name, "compare", 0, count, best_seconds(repeats, [&] {
+      for (std::size_t j = 1; j < items.size(); ++j) {
+        sink += items[j - 1].compare(items[j]) < 0;
+      }
+    }));
+
+    std::size_t lookups = 0;
+    for (auto &item : items) {
+      lookups += item.is_object() ? item.object_items().size() : item.array_items().size();
+    }
+    report(name, "lookup", 0, lookups, best_seconds(repeats, [&] {
+      for (auto &item : items) {
+        if (item.is_object()) {
+          for (auto &entry : item.object_items()) {
+            sink += item.object_items().find(entry.first.ref())->second.type();
+          }
+        } else {
+          for (std::size_t j = 0; j < item.array_items().size(); ++j) {
+            sink += item[j].type();
+          }
+        }
+      }
+    }));
+  }
+  return sink == 0 ? 1 : 0;
+}
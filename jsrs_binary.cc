@@ -0,0 +1,293 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_binary.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace jstp {
+
+const char kBinaryMagic[4] = {'J', 'S', 'B', 1};
+
+static void put_u32(std::uint32_t value, char *out) {
+  out[0] = static_cast<char>(value);
+  out[1] = static_cast<char>(value >> 8);
+  out[2] = static_cast<char>(value >> 16);
+  out[3] = static_cast<char>(value >> 24);
+}
+
+static std::uint32_t get_u32(const char *in) {
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(in);
+  return static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8 |
+         static_cast<std::uint32_t>(bytes[2]) << 16 | static_cast<std::uint32_t>(bytes[3]) << 24;
+}
+
+static void append_u32(std::uint32_t value, std::string &out) {
+  char bytes[4];
+  put_u32(value, bytes);
+  out.append(bytes, 4);
+}
+
+static std::uint32_t checked_u32(std::size_t value) {
+  if (value > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("jstp::encode");
+  }
+  return static_cast<std::uint32_t>(value);
+}
+
+static void append_double(double value, std::string &out) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  append_u32(static_cast<std::uint32_t>(bits), out);
+  append_u32(static_cast<std::uint32_t>(bits >> 32), out);
+}
+
+static double get_double(const char *in) {
+  const std::uint64_t bits = get_u32(in) | static_cast<std::uint64_t>(get_u32(in + 4)) << 32;
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static void append_chars(StringRef chars, std::string &out) {
+  append_u32(checked_u32(chars.size()), out);
+  out.append(chars.data(), chars.size());
+}
+
+static void encode_value(const Record &record, std::string &out) {
+  const std::size_t start = out.size();
+  out += static_cast<char>(record.type());
+  switch (record.type()) {
+    case Record::UNDEFINED:
+    case Record::NUL:
+      break;
+    case Record::BOOL:
+      out += static_cast<char>(record.bool_value());
+      break;
+    case Record::NUMBER:
+      append_double(record.number_value(), out);
+      break;
+    case Record::STRING:
+      append_chars(record.string_ref(), out);
+      break;
+    case Record::ARRAY: {
+      const Record::array &items = record.array_items();
+      append_u32(checked_u32(items.size()), out);
+      std::size_t offset = out.size();
+      out.append(items.size() * 4, '\0');
+      for (auto i = items.begin(); i != items.end(); ++i, offset += 4) {
+        put_u32(checked_u32(out.size() - start), &out[offset]);
+        encode_value(*i, out);
+      }
+      break;
+    }
+    case Record::OBJECT: {
+      const Record::object &entries = record.object_items();
+      append_u32(checked_u32(entries.size()), out);
+      std::size_t offset = out.size();
+      out.append(entries.size() * 4, '\0');
+      for (auto i = entries.begin(); i != entries.end(); ++i, offset += 4) {
+        put_u32(checked_u32(out.size() - start), &out[offset]);
+        append_chars(i->first.ref(), out);
+        encode_value(i->second, out);
+      }
+      break;
+    }
+  }
+}
+
+void encode(const Record &record, std::string &out) {
+  out.append(kBinaryMagic, sizeof(kBinaryMagic));
+  encode_value(record, out);
+}
+
+std::string encode(const Record &record) {
+  std::string result;
+  encode(record, result);
+  return result;
+}
+
+// Returns a pointer past the value at begin, or nullptr if it is malformed or is cut by end
+static const char *check_value(const char *begin, const char *end) {
+  if (begin == end) {
+    return nullptr;
+  }
+  const std::size_t left = end - begin - 1;
+  switch (*begin) {
+    case Record::UNDEFINED:
+    case Record::NUL:
+      return begin + 1;
+    case Record::BOOL:
+      return left >= 1 && (begin[1] == 0 || begin[1] == 1) ? begin + 2 : nullptr;
+    case Record::NUMBER:
+      return left >= 8 ? begin + 9 : nullptr;
+    case Record::STRING:
+      return left >= 4 && left - 4 >= get_u32(begin + 1) ? begin + 5 + get_u32(begin + 1) : nullptr;
+    case Record::ARRAY:
+    case Record::OBJECT: {
+      if (left < 4 || (left - 4) / 4 < get_u32(begin + 1)) {
+        return nullptr;
+      }
+      const std::uint32_t count = get_u32(begin + 1);
+      const char *i = begin + 5 + std::size_t(count) * 4;
+      for (std::uint32_t item = 0; item < count; ++item) {
+        if (get_u32(begin + 5 + item * 4) != static_cast<std::size_t>(i - begin)) {
+          return nullptr;
+        }
+        if (*begin == Record::OBJECT) {
+          if (end - i < 4 || static_cast<std::size_t>(end - i - 4) < get_u32(i)) {
+            return nullptr;
+          }
+          i += 4 + get_u32(i);
+        }
+        i = check_value(i, end);
+        if (!i) {
+          return nullptr;
+        }
+      }
+      return i;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+Record decode(const char *data, std::size_t size, std::string &err, MemoryResource *memory) {
+  return BinaryView::open(data, size, err).record(memory);
+}
+
+Record decode(const std::string &in, std::string &err, MemoryResource *memory) {
+  return decode(in.data(), in.size(), err, memory);
+}
+
+// BinaryView implementation
+
+BinaryView BinaryView::open(const char *data, std::size_t size, std::string &err) {
+  if (size < sizeof(kBinaryMagic) || std::memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+    err = "Invalid binary format: unknown header";
+    return BinaryView();
+  }
+  const char *end = data + size;
+  const char *value_end = check_value(data + sizeof(kBinaryMagic), end);
+  if (value_end != end) {
+    err = value_end ? "Invalid binary format: trailing data" : "Invalid binary format";
+    return BinaryView();
+  }
+  return BinaryView(data + sizeof(kBinaryMagic));
+}
+
+Record::Type BinaryView::type() const {
+  return value ? static_cast<Record::Type>(*value) : Record::UNDEFINED;
+}
+
+bool BinaryView::bool_value() const {
+  return type() == Record::BOOL && value[1];
+}
+
+double BinaryView::number_value() const {
+  return type() == Record::NUMBER ? get_double(value + 1) : 0.0;
+}
+
+StringRef BinaryView::string_ref() const {
+  return type() == Record::STRING ? StringRef(value + 5, get_u32(value + 1)) : StringRef();
+}
+
+std::size_t BinaryView::size() const {
+  const Record::Type kind = type();
+  return kind == Record::ARRAY || kind == Record::OBJECT ? get_u32(value + 1) : 0;
+}
+
+BinaryView BinaryView::operator[](std::size_t i) const {
+  if (i >= size()) {
+    return BinaryView();
+  }
+  const char *item = value + get_u32(value + 5 + i * 4);
+  return BinaryView(type() == Record::OBJECT ? item + 4 + get_u32(item) : item);
+}
+
+BinaryView BinaryView::operator[](StringRef key) const {
+  if (type() != Record::OBJECT) {
+    return BinaryView();
+  }
+  const std::size_t count = size();
+  for (std::size_t i = 0; i < count; ++i) {
+    const char *entry = value + get_u32(value + 5 + i * 4);
+    if (StringRef(entry + 4, get_u32(entry)) == key) {
+      return BinaryView(entry + 4 + get_u32(entry));
+    }
+  }
+  return BinaryView();
+}
+
+StringRef BinaryView::key(std::size_t i) const {
+  if (type() != Record::OBJECT || i >= size()) {
+    return StringRef();
+  }
+  const char *entry = value + get_u32(value + 5 + i * 4);
+  return StringRef(entry + 4, get_u32(entry));
+}
+
+Record BinaryView::record(MemoryResource *memory) const {
+  switch (type()) {
+    case Record::UNDEFINED:
+      return Record();
+    case Record::NUL:
+      return Record(nullptr);
+    case Record::BOOL:
+      return Record(bool_value());
+    case Record::NUMBER:
+      return Record(number_value());
+    case Record::STRING: {
+      const StringRef chars = string_ref();
+      return Record(chars.data(), chars.size(), memory);
+    }
+    case Record::ARRAY: {
+      const std::size_t count = size();
+      const Allocator<Record> allocator(memory);
+      Record::array items(allocator);
+      items.reserve(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        items.push_back((*this)[i].record(memory));
+      }
+      return Record(std::move(items));
+    }
+    case Record::OBJECT: {
+      const std::size_t count = size();
+      const Allocator<Record::object::value_type> allocator(memory);
+      Record::object entries(allocator);
+      entries.reserve(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        entries.emplace(Key(key(i)), (*this)[i].record(memory));
+      }
+      return Record(std::move(entries));
+    }
+  }
+  return Record();
+}
+
+// end of BinaryView implementation
+
+}
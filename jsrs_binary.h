@@ -0,0 +1,118 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JSTP_CPP_JSRS_BINARY_H
+#define JSTP_CPP_JSRS_BINARY_H
+
+#include "jsrs.h"
+
+#include <cstdint>
+#include <string>
+
+namespace jstp {
+
+/**
+ * Compact binary form of a Record for caches and interprocess messages
+ *
+ * The encoding starts with the four bytes of kBinaryMagic, the last one is the version,
+ * and is followed by the root value. Every value is a byte of its Record::Type and a payload,
+ * integers and doubles are little-endian and are not aligned:
+ *   BOOL     a byte of 0 or 1
+ *   NUMBER   8 bytes of the double
+ *   STRING   uint32 length and the characters
+ *   ARRAY    uint32 count, uint32 offsets of the items from the type byte of the array, the items
+ *   OBJECT   uint32 count, uint32 offsets of the entries from the type byte of the object, the entries,
+ *            each one is uint32 key length, the characters of the key and the value
+ * Entries of objects are kept in the order of iteration of the object.
+ */
+extern const char kBinaryMagic[4];
+
+/**
+ * Appends the encoding of record to out, throws std::length_error if a string,
+ * an array or an object does not fit 4 GiB
+ */
+void encode(const Record &record, std::string &out);
+std::string encode(const Record &record);
+
+/**
+ * Builds a Record of an encoding, returns UNDEFINED and sets err if the encoding is malformed.
+ * Strings and containers take memory from memory if it is given.
+ */
+Record decode(const char *data, std::size_t size, std::string &err, MemoryResource *memory = nullptr);
+Record decode(const std::string &in, std::string &err, MemoryResource *memory = nullptr);
+
+/**
+ * Read-only access to an encoded value in place
+ *
+ * A view refers to the encoding and is valid while it is, nothing is copied or decoded. Items
+ * and entries are found by their offsets at once, keys are searched linearly. A default constructed
+ * view, and the ones returned for a missing item or key, are UNDEFINED.
+ */
+class BinaryView {
+ public:
+  BinaryView() : value(nullptr) { }
+
+  /**
+   * Checks the whole encoding, returns an UNDEFINED view and sets err if it is malformed,
+   * so the views obtained from the result need no checks
+   */
+  static BinaryView open(const char *data, std::size_t size, std::string &err);
+
+  Record::Type type() const;
+
+  bool bool_value() const;
+  double number_value() const;
+  StringRef string_ref() const;
+
+  /**
+   * Returns the number of items of an array or of entries of an object, 0 otherwise
+   */
+  std::size_t size() const;
+
+  /**
+   * Returns the item of an array or the value of the entry of an object at position i
+   */
+  BinaryView operator[](std::size_t i) const;
+  BinaryView operator[](StringRef key) const;
+
+  /**
+   * Returns the key of the entry of an object at position i
+   */
+  StringRef key(std::size_t i) const;
+
+  /**
+   * Builds a Record of the value
+   */
+  Record record(MemoryResource *memory = nullptr) const;
+
+ private:
+  explicit BinaryView(const char *value) : value(value) { }
+
+  // Type byte of the value
+  const char *value;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_BINARY_H
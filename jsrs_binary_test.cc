@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_binary.h"
+
+#include <cmath>
+
+TEST(jsrs_binary_test, jsrs_binary_test_RoundTrip) {
+  std::vector<std::string> arr = testData::validArray();
+  for (auto &iterator : arr) {
+    std::string err = "";
+    jstp::Record expected = jstp::Record::parse(iterator, err);
+    std::string encoded = jstp::encode(expected);
+    jstp::Record decoded = jstp::decode(encoded, err);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(expected, decoded);
+    EXPECT_EQ(expected.stringify(), decoded.stringify());
+  }
+
+  std::string err = "";
+  jstp::Record negative = jstp::decode(jstp::encode(jstp::Record(-0.0)), err);
+  EXPECT_TRUE(std::signbit(negative.number_value()));
+  EXPECT_TRUE(std::isnan(jstp::decode(jstp::encode(jstp::Record(std::nan(""))), err).number_value()));
+
+  jstp::Record ordered = jstp::Record::parse("{z:1,a:[true,,null],m:'x\\ny'}", err);
+  jstp::Arena arena;
+  jstp::Record decoded = jstp::decode(jstp::encode(ordered), err, &arena);
+  EXPECT_EQ("{z:1,a:[true,,null],m:\"x\\ny\"}", decoded.stringify());
+  EXPECT_LT(0u, arena.bytes_allocated());
+}
+
+TEST(jsrs_binary_test, jsrs_binary_test_Layout) {
+  std::string err = "";
+  jstp::Record record = jstp::Record::parse("{a:[1,true],b:'xy'}", err);
+  const std::string encoded = jstp::encode(record);
+  const std::string expected = std::string("JSB\x01", 4) +
+      std::string("\x06\x02\x00\x00\x00\x0d\x00\x00\x00\x2a\x00\x00\x00", 13) +
+      std::string("\x01\x00\x00\x00" "a" "\x05\x02\x00\x00\x00\x0d\x00\x00\x00\x16\x00\x00\x00", 18) +
+      std::string("\x03\x00\x00\x00\x00\x00\x00\xf0\x3f" "\x02\x01", 11) +
+      std::string("\x01\x00\x00\x00" "b" "\x04\x02\x00\x00\x00" "xy", 12);
+  EXPECT_EQ(expected, encoded);
+}
+
+TEST(jsrs_binary_test, jsrs_binary_test_View) {
+  std::string err = "";
+  jstp::Record record = jstp::Record::parse("{name:'Marcus',born:121,roles:['emperor','philosopher'],alive:false,"
+                                            "wife:null,heir:undefined}", err);
+  const std::string encoded = jstp::encode(record);
+  jstp::BinaryView view = jstp::BinaryView::open(encoded.data(), encoded.size(), err);
+  EXPECT_EQ("", err);
+  ASSERT_EQ(jstp::Record::OBJECT, view.type());
+  ASSERT_EQ(6u, view.size());
+  EXPECT_EQ(jstp::StringRef("name"), view.key(0));
+  EXPECT_EQ(jstp::StringRef("heir"), view.key(5));
+  EXPECT_EQ(jstp::StringRef("Marcus"), view["name"].string_ref());
+  EXPECT_EQ(encoded.data() + 46, view["name"].string_ref().data());
+  EXPECT_EQ(121, view["born"].number_value());
+  EXPECT_EQ(2u, view["roles"].size());
+  EXPECT_EQ(jstp::StringRef("philosopher"), view["roles"][1].string_ref());
+  EXPECT_EQ(jstp::Record::BOOL, view["alive"].type());
+  EXPECT_FALSE(view["alive"].bool_value());
+  EXPECT_EQ(jstp::Record::NUL, view["wife"].type());
+  EXPECT_EQ(jstp::Record::UNDEFINED, view["heir"].type());
+  EXPECT_EQ(jstp::Record::UNDEFINED, view["missing"].type());
+  EXPECT_EQ(jstp::Record::UNDEFINED, view["roles"][2].type());
+  EXPECT_EQ(jstp::Record::UNDEFINED, view["name"][0].type());
+  EXPECT_EQ(0u, view["name"].size());
+  EXPECT_EQ(record["roles"], view["roles"].record());
+  EXPECT_EQ(record, view.record());
+}
+
+TEST(jsrs_binary_test, jsrs_binary_test_Malformed) {
+  std::string err = "";
+  jstp::Record record = jstp::Record::parse("{a:[1,'two',{b:null}],c:true}", err);
+  const std::string encoded = jstp::encode(record);
+  for (std::size_t size = 0; size < encoded.size(); ++size) {
+    err = "";
+    EXPECT_EQ(jstp::Record(), jstp::decode(encoded.data(), size, err));
+    EXPECT_NE("", err);
+  }
+  for (std::size_t i = 0; i < encoded.size(); ++i) {
+    std::string corrupted = encoded;
+    corrupted[i] ^= 0x5a;
+    err = "";
+    jstp::decode(corrupted, err);  // Must fail or succeed without reading out of bounds
+  }
+  err = "";
+  jstp::decode(encoded + '\0', err);
+  EXPECT_EQ("Invalid binary format: trailing data", err);
+  err = "";
+  EXPECT_EQ(jstp::Record::UNDEFINED, jstp::BinaryView::open("JSB\x02\x01", 5, err).type());
+  EXPECT_EQ("Invalid binary format: unknown header", err);
+}
@@ -0,0 +1,254 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_corpus.h"
+
+namespace jstp {
+
+static const char *const kWords[] = {
+    "Marcus", "Aurelius", "Rome", "Kiev", "passport", "street", "Pobedy", "building", "metarhia", "impress",
+    "session", "packet", "handshake", "event", "callback", "inspect", "state", "health", "status", "ok"
+};
+static const std::size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+const int Corpus::kShapes;
+
+std::string Corpus::generate(Shape shape, std::size_t size, std::size_t &count) {
+  std::string out = "[";
+  out.reserve(size + size / 8);
+  count = 0;
+  while (out.size() < size) {
+    if (count) {
+      out += shape == COMMENTED ? ",\n" : ",";
+    }
+    add_record(shape == MIXED ? static_cast<Shape>(1 + below(kShapes - 1)) : shape, out);
+    ++count;
+  }
+  out += ']';
+  return out;
+}
+
+const char *Corpus::name(Shape shape) {
+  switch (shape) {
+    case MIXED:
+      return "mixed";
+    case WIDE:
+      return "wide";
+    case DEEP:
+      return "deep";
+    case NUMBERS:
+      return "numbers";
+    case STRINGS:
+      return "strings";
+    case COMMENTED:
+      return "commented";
+    case SPARSE:
+      return "sparse";
+  }
+  return "unknown";
+}
+
+std::uint64_t Corpus::next() {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ull;
+}
+
+void Corpus::add_record(Shape shape, std::string &out) {
+  switch (shape) {
+    case WIDE:
+      add_wide(out);
+      break;
+    case DEEP:
+      add_deep(out);
+      break;
+    case NUMBERS:
+      add_numbers(out);
+      break;
+    case STRINGS:
+      add_strings(out);
+      break;
+    case COMMENTED:
+      add_commented(out);
+      break;
+    default:
+      add_sparse(out);
+  }
+}
+
+void Corpus::add_wide(std::string &out) {
+  const std::size_t fields = 32 + below(64);
+  out += '{';
+  for (std::size_t i = 0; i < fields; ++i) {
+    if (i) {
+      out += ',';
+    }
+    out += "field" + std::to_string(i) + ':';
+    switch (below(5)) {
+      case 0:
+        add_number(out);
+        break;
+      case 1:
+        out += below(2) ? "true" : "false";
+        break;
+      case 2:
+        out += "null";
+        break;
+      default:
+        out += '\'';
+        add_word(out);
+        out += '\'';
+    }
+  }
+  out += '}';
+}
+
+void Corpus::add_deep(std::string &out) {
+  const std::size_t depth = 8 + below(56);
+  std::string closing;
+  for (std::size_t i = 0; i < depth; ++i) {
+    if (below(4)) {
+      out += "{obj:";
+      closing += '}';
+    } else {
+      out += '[';
+      closing += ']';
+    }
+  }
+  add_number(out);
+  out.append(closing.rbegin(), closing.rend());
+}
+
+void Corpus::add_numbers(std::string &out) {
+  const std::size_t size = 16 + below(112);
+  out += '[';
+  for (std::size_t i = 0; i < size; ++i) {
+    if (i) {
+      out += ',';
+    }
+    add_number(out);
+  }
+  out += ']';
+}
+
+void Corpus::add_strings(std::string &out) {
+  out += "{id:";
+  add_number(out);
+  out += ",title:'";
+  add_text(16 + below(48), out);
+  out += "',body:'";
+  add_text(256 + below(4096), out);
+  out += "',tags:['";
+  add_word(out);
+  out += "','";
+  add_word(out);
+  out += "']}";
+}
+
+void Corpus::add_commented(std::string &out) {
+  out += "{\n  // Person\n  name: '";
+  add_word(out);
+  out += ' ';
+  add_word(out);
+  out += "',\n  age: ";
+  add_number(out);
+  out += ", /* years */\n  address: {\n    city: '";
+  add_word(out);
+  out += "', // current\n    zip: '";
+  out += std::to_string(10000 + below(90000));
+  out += "'\n  },\n  /* contacts\n     are optional */\n  phones: [\n    '+380";
+  out += std::to_string(100000000 + below(900000000));
+  out += "' // mobile\n  ]\n}";
+}
+
+void Corpus::add_sparse(std::string &out) {
+  switch (below(3)) {
+    case 0:
+      out += "[,'me',]";
+      break;
+    case 1:
+      out += "{a:undefined,b:[,,";
+      add_number(out);
+      out += ",,],c:null}";
+      break;
+    default:
+      out += "[";
+      for (std::size_t i = below(8); i > 0; --i) {
+        out += below(2) ? "," : "undefined,";
+      }
+      out += "'";
+      add_word(out);
+      out += "']";
+  }
+}
+
+void Corpus::add_number(std::string &out) {
+  switch (below(4)) {
+    case 0:
+      out += std::to_string(below(1000));
+      break;
+    case 1:
+      out += '-';
+      out += std::to_string(below(1000000));
+      break;
+    case 2:
+      out += std::to_string(below(100000));
+      out += '.';
+      out += std::to_string(below(1000));
+      break;
+    default:
+      out += std::to_string(1 + below(9));
+      out += '.';
+      out += std::to_string(below(100000));
+      out += below(2) ? "e-" : "e+";
+      out += std::to_string(below(300));
+  }
+}
+
+void Corpus::add_word(std::string &out) {
+  out += kWords[below(kWordCount)];
+}
+
+void Corpus::add_text(std::size_t length, std::string &out) {
+  const std::size_t end = out.size() + length;
+  while (out.size() < end) {
+    add_word(out);
+    switch (below(16)) {
+      case 0:
+        out += "\\n";
+        break;
+      case 1:
+        out += "\\'";
+        break;
+      case 2:
+        out += "\\u00e9";
+        break;
+      default:
+        out += ' ';
+    }
+  }
+}
+
+}
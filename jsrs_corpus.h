@@ -0,0 +1,88 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Generator of benchmark inputs, not a part of the library
+
+#ifndef JSTP_CPP_JSRS_CORPUS_H
+#define JSTP_CPP_JSRS_CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace jstp {
+
+/**
+ * Deterministic generator of inputs shaped like real traffic
+ *
+ * A corpus is a top level array of records of one shape. The output depends only on the seed,
+ * the shape and the size, so results of different builds and machines are comparable.
+ */
+class Corpus {
+ public:
+  enum Shape {
+    MIXED = 0,  // Small records of all the other shapes
+    WIDE,       // Objects of many fields
+    DEEP,       // Nesting like obj:{obj:{...}}
+    NUMBERS,    // Arrays of integers, decimals and exponents
+    STRINGS,    // Long strings with escape sequences
+    COMMENTED,  // Pretty-printed records with comments
+    SPARSE      // Arrays and objects with holes and undefined values
+  };
+
+  static const int kShapes = SPARSE + 1;
+
+  explicit Corpus(std::uint64_t seed = 1) : state(seed ? seed : 1) { }
+
+  /**
+   * Returns an array of records of shape that is at least size characters long,
+   * count is set to the number of records
+   */
+  std::string generate(Shape shape, std::size_t size, std::size_t &count);
+
+  static const char *name(Shape shape);
+
+ private:
+  // xorshift64*, unlike the distributions of <random> it gives the same numbers everywhere
+  std::uint64_t next();
+  std::size_t below(std::size_t bound) { return static_cast<std::size_t>(next() % bound); }
+
+  void add_record(Shape shape, std::string &out);
+  void add_wide(std::string &out);
+  void add_deep(std::string &out);
+  void add_numbers(std::string &out);
+  void add_strings(std::string &out);
+  void add_commented(std::string &out);
+  void add_sparse(std::string &out);
+
+  void add_number(std::string &out);
+  void add_word(std::string &out);
+  void add_text(std::size_t length, std::string &out);
+
+  std::uint64_t state;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_CORPUS_H
@@ -0,0 +1,241 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_file.h"
+#include "jsrs_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace jstp {
+
+// MappedFile implementation
+
+bool MappedFile::open(const std::string &path, std::string &err) {
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    err = "Cannot open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    err = "Cannot stat " + path + ": " + std::strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  const std::size_t size = static_cast<std::size_t>(status.st_size);
+  if (size) {  // Empty mappings are not allowed
+    void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      err = "Cannot map " + path + ": " + std::strerror(errno);
+      ::close(fd);
+      return false;
+    }
+    mapping = address;
+    length = size;
+  }
+  ::close(fd);  // The mapping keeps the file
+  return true;
+}
+
+void MappedFile::close() {
+  if (mapping) {
+    ::munmap(mapping, length);
+  }
+  mapping = nullptr;
+  length = 0;
+}
+
+static std::size_t page_size() {
+  static const std::size_t size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+// Applies advice to the pages between begin and end, rounded outwards or inwards
+static void advise(void *mapping, std::size_t length, std::size_t begin, std::size_t end, int advice,
+                   bool outwards) {
+  const std::size_t page = page_size();
+  end = std::min(end, length);
+  if (outwards) {
+    begin = begin / page * page;
+    end = (end + page - 1) / page * page;
+  } else {
+    begin = (begin + page - 1) / page * page;
+    end = end == length ? (end + page - 1) / page * page : end / page * page;
+  }
+  if (mapping && begin < end) {
+    ::madvise(static_cast<char *>(mapping) + begin, end - begin, advice);
+  }
+}
+
+void MappedFile::advise_sequential(std::size_t begin, std::size_t end) const {
+  advise(mapping, length, begin, end, MADV_SEQUENTIAL, true);
+}
+
+void MappedFile::prefetch(std::size_t begin, std::size_t end) const {
+  advise(mapping, length, begin, end, MADV_WILLNEED, true);
+}
+
+void MappedFile::release(std::size_t begin, std::size_t end) const {
+  advise(mapping, length, begin, end, MADV_DONTNEED, false);
+}
+
+// end of MappedFile implementation
+
+// FileReader implementation
+
+const std::size_t FileReader::kDefaultWindow;
+
+FileReader::FileReader(std::size_t window) : window(window), state(kFinished), offset(0), released(0) { }
+
+// Skips whitespace, comments and packet terminators
+static const char *skip_separators(const char *begin, const char *end) {
+  begin = skip_spaces(begin, end);
+  while (begin < end && *begin == '\0') {
+    begin = skip_spaces(begin + 1, end);
+  }
+  return begin;
+}
+
+bool FileReader::open(const std::string &path, Layout layout, std::string &err) {
+  state = kFinished;
+  offset = 0;
+  released = 0;
+  if (!file.open(path, err)) {
+    return false;
+  }
+  file.advise_sequential(0, file.size());
+  file.prefetch(0, window);
+  if (layout == SEQUENCE) {
+    state = kRecord;
+    return true;
+  }
+  const char *begin = file.data();
+  const char *i = skip_spaces(begin, begin + file.size());
+  if (i == begin + file.size() || *i != '[') {
+    err = "Invalid format: the file is not an array";
+    return false;
+  }
+  state = kFirstItem;
+  offset = i + 1 - begin;
+  return true;
+}
+
+bool FileReader::fail(const char *message, std::string &err) {
+  err = message;
+  state = kFinished;
+  return false;
+}
+
+void FileReader::advance(const char *i) {
+  offset = i - file.data();
+  if (offset - released >= window) {
+    file.release(released, offset);
+    file.prefetch(offset, offset + window);
+    released = offset;
+  }
+}
+
+bool FileReader::next(Record &record, std::string &err) {
+  const char *begin = file.data();
+  const char *end = begin + file.size();
+  const char *i = begin + offset;
+  switch (state) {
+    case kFinished:
+      return false;
+    case kArrayEnd:
+      state = kFinished;
+      return skip_spaces(i, end) != end && fail("Invalid format", err);
+    case kRecord:
+      i = skip_separators(i, end);
+      if (i == end) {
+        state = kFinished;
+        return false;
+      }
+      if (*i == ',' || *i == ']') {
+        return fail("Invalid format", err);
+      }
+      break;
+    case kFirstItem:
+    case kItem:
+      i = skip_spaces(i, end);
+      if (i == end) {
+        return fail("Invalid format in array: missed closing bracket", err);
+      }
+      if (*i == ']') {
+        const bool empty = state == kFirstItem;
+        state = kArrayEnd;
+        advance(i + 1);
+        if (empty) {
+          return next(record, err);
+        }
+        record = Record();  // A trailing comma leaves a hole, as in arrays
+        return true;
+      }
+      break;
+  }
+
+  Record::Type type;
+  if (!get_type(i, end, type)) {
+    return fail(state == kRecord ? "Invalid type" : "Invalid format in array", err);
+  }
+  JSTP_CPP_TIME(parse_ns);
+  RecordBuilder builder(nullptr, &KeyPool::local(), false);
+  Reader<RecordBuilder> reader(end, builder);
+  const char *item_end = reader.parse_value(i, type);
+  if (!item_end) {
+    return fail(reader.get_error(), err);
+  }
+  JSTP_CPP_COUNT(pending_stats().bytes_parsed += item_end - i);
+  record = builder.result();
+  if (state == kRecord) {
+    advance(item_end);
+    return true;
+  }
+  i = skip_spaces(item_end, end);
+  if (i < end && *i == ',') {
+    state = kItem;
+    advance(i + 1);
+  } else if (i < end && *i == ']') {
+    state = kArrayEnd;
+    advance(i + 1);
+  } else {
+    state = kFinished;
+    err = "Invalid format in array: missed semicolon";
+    record = Record();
+    return false;
+  }
+  return true;
+}
+
+// end of FileReader implementation
+
+}
@@ -0,0 +1,122 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JSTP_CPP_JSRS_FILE_H
+#define JSTP_CPP_JSRS_FILE_H
+
+#include "jsrs.h"
+
+#include <string>
+
+namespace jstp {
+
+/**
+ * Read-only memory mapping of a whole file
+ */
+class MappedFile {
+ public:
+  MappedFile() : mapping(nullptr), length(0) { }
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * Maps the file at path, returns false and sets err if it cannot be opened or mapped
+   */
+  bool open(const std::string &path, std::string &err);
+  void close();
+
+  const char *data() const { return static_cast<const char *>(mapping); }
+  std::size_t size() const { return length; }
+
+  /**
+   * Hints of the access to the pages between the offsets begin and end. The hints cover pages
+   * that are partly in the range, release() skips them. Released pages may still be read,
+   * the kernel is only allowed to drop them from memory.
+   */
+  void advise_sequential(std::size_t begin, std::size_t end) const;
+  void prefetch(std::size_t begin, std::size_t end) const;
+  void release(std::size_t begin, std::size_t end) const;
+
+ private:
+  void *mapping;
+  std::size_t length;
+};
+
+/**
+ * Reader of the records of a large file one at a time
+ *
+ * The file is either a single top level array, which items are read in turn, or a sequence of records
+ * separated by whitespace, comments or '\0' terminators. It is mapped into memory and read
+ * sequentially, every window bytes the pages ahead are prefetched and the ones already read are released,
+ * so the resident part of the file stays about two windows. Records are copied out of the file.
+ */
+class FileReader {
+ public:
+  static const std::size_t kDefaultWindow = 16 * 1024 * 1024;
+
+  enum Layout {
+    ARRAY, SEQUENCE
+  };
+
+  explicit FileReader(std::size_t window = kDefaultWindow);
+
+  /**
+   * Maps the file at path, returns false and sets err if it cannot be opened or, for an ARRAY,
+   * does not start with an opening bracket
+   */
+  bool open(const std::string &path, Layout layout, std::string &err);
+
+  /**
+   * Reads the next record, returns false at the end of the file or if it is malformed,
+   * then err is set. Keys of objects are taken from the pool of the calling thread.
+   */
+  bool next(Record &record, std::string &err);
+
+  /**
+   * Returns the offset in the file past the last record read
+   */
+  std::size_t position() const { return offset; }
+
+ private:
+  enum State {
+    kFirstItem, kItem, kArrayEnd, kRecord, kFinished
+  };
+
+  bool fail(const char *message, std::string &err);
+  // Moves the position to i and hints the pages around it
+  void advance(const char *i);
+
+  MappedFile file;
+  const std::size_t window;
+  State state;
+  std::size_t offset;
+  // Offset up to which the pages are released
+  std::size_t released;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_FILE_H
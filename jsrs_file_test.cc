@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+// Temporary file that is removed with the object
+class TempFile {
+ public:
+  explicit TempFile(const std::string &content) {
+    char name[] = "/tmp/jsrs_file_testXXXXXX";
+    int fd = mkstemp(name);
+    path = name;
+    EXPECT_EQ(static_cast<ssize_t>(content.size()), write(fd, content.data(), content.size()));
+    close(fd);
+  }
+
+  ~TempFile() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+static std::vector<jstp::Record> read_all(const std::string &content, jstp::FileReader::Layout layout,
+                                          std::string &err, std::size_t window = jstp::FileReader::kDefaultWindow) {
+  TempFile file(content);
+  jstp::FileReader reader(window);
+  std::vector<jstp::Record> records;
+  if (reader.open(file.path, layout, err)) {
+    jstp::Record record;
+    while (reader.next(record, err)) {
+      records.push_back(record);
+    }
+  }
+  return records;
+}
+
+TEST(jsrs_file_test, jsrs_file_test_Array) {
+  const std::string in = " [{a:1}, 'x', , 3, /* four */ [1,2],] ";
+  std::string err = "";
+  std::vector<jstp::Record> records = read_all(in, jstp::FileReader::ARRAY, err);
+  EXPECT_EQ("", err);
+  jstp::Record expected = jstp::Record::parse(in, err);
+  EXPECT_EQ(expected.array_items().size(), records.size());
+  EXPECT_EQ(expected, jstp::Record(records));
+
+  EXPECT_TRUE(read_all("[]", jstp::FileReader::ARRAY, err).empty());
+  EXPECT_EQ("", err);
+
+  std::string large = "[";
+  for (int i = 0; i < 100000; ++i) {
+    large += "{id:" + std::to_string(i) + ",name:'item'},";
+  }
+  large += "{id:-1}]";
+  TempFile file(large);
+  jstp::FileReader reader(4096);
+  ASSERT_TRUE(reader.open(file.path, jstp::FileReader::ARRAY, err));
+  jstp::Record record;
+  std::size_t count = 0;
+  while (reader.next(record, err)) {
+    EXPECT_EQ(count < 100000 ? static_cast<double>(count) : -1, record["id"].number_value());
+    ++count;
+  }
+  EXPECT_EQ("", err);
+  EXPECT_EQ(100001u, count);
+  EXPECT_EQ(large.size(), reader.position());
+}
+
+TEST(jsrs_file_test, jsrs_file_test_Sequence) {
+  std::string err = "";
+  const char in[] = "{a:1}\n[2]\0'three' // comment\n 4\0\0 null";
+  std::vector<jstp::Record> records = read_all(std::string(in, sizeof(in) - 1), jstp::FileReader::SEQUENCE, err);
+  EXPECT_EQ("", err);
+  ASSERT_EQ(5u, records.size());
+  EXPECT_EQ(1, records[0]["a"].number_value());
+  EXPECT_EQ(2, records[1][0].number_value());
+  EXPECT_EQ("three", records[2].string_value());
+  EXPECT_EQ(4, records[3].number_value());
+  EXPECT_TRUE(records[4].is_null());
+
+  EXPECT_TRUE(read_all("", jstp::FileReader::SEQUENCE, err).empty());
+  EXPECT_EQ("", err);
+}
+
+TEST(jsrs_file_test, jsrs_file_test_Malformed) {
+  std::string err = "";
+  EXPECT_EQ(0u, read_all("[1 2]", jstp::FileReader::ARRAY, err).size());
+  EXPECT_EQ("Invalid format in array: missed semicolon", err);
+  err = "";
+  EXPECT_EQ(1u, read_all("[1,", jstp::FileReader::ARRAY, err).size());
+  EXPECT_EQ("Invalid format in array: missed closing bracket", err);
+  err = "";
+  EXPECT_EQ(1u, read_all("[1] 2", jstp::FileReader::ARRAY, err).size());
+  EXPECT_EQ("Invalid format", err);
+  err = "";
+  EXPECT_EQ(0u, read_all("{a:1}", jstp::FileReader::ARRAY, err).size());
+  EXPECT_EQ("Invalid format: the file is not an array", err);
+  err = "";
+  EXPECT_EQ(1u, read_all("{a:1} {b:", jstp::FileReader::SEQUENCE, err).size());
+  EXPECT_NE("", err);
+  err = "";
+  EXPECT_EQ(1u, read_all("1, 2", jstp::FileReader::SEQUENCE, err).size());
+  EXPECT_EQ("Invalid format", err);
+
+  jstp::FileReader reader;
+  err = "";
+  EXPECT_FALSE(reader.open("/nonexistent/records", jstp::FileReader::SEQUENCE, err));
+  EXPECT_EQ(0u, err.find("Cannot open /nonexistent/records"));
+  jstp::Record record;
+  EXPECT_FALSE(reader.next(record, err));
+}
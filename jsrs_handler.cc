@@ -0,0 +1,71 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_handler.h"
+#include "jsrs_reader.h"
+#include "jsrs_string.h"
+
+namespace jstp {
+
+// Passes events of Reader to a Handler, decoding escape sequences of strings into one reused buffer
+class HandlerAdapter {
+ public:
+  explicit HandlerAdapter(Handler &handler) : handler(handler) { }
+
+  bool on_undefined() { return handler.on_undefined(); }
+  bool on_null() { return handler.on_null(); }
+  bool on_bool(bool value) { return handler.on_bool(value); }
+  bool on_number(double value) { return handler.on_number(value); }
+
+  bool on_string(const char *data, std::size_t length, bool escaped) {
+    if (!escaped) {
+      return handler.on_string(StringRef(data, length));
+    }
+    decoded.clear();
+    unescape(data, data + length, decoded);
+    return handler.on_string(decoded);
+  }
+
+  bool on_object_begin() { return handler.on_object_begin(); }
+  bool on_key(StringRef key) { return handler.on_key(key); }
+  bool on_object_end() { return handler.on_object_end(); }
+  bool on_array_begin() { return handler.on_array_begin(); }
+  bool on_array_end() { return handler.on_array_end(); }
+
+ private:
+  Handler &handler;
+  std::string decoded;
+};
+
+bool parse(const std::string &in, Handler &handler, std::string &err) {
+  HandlerAdapter adapter(handler);
+  const char *error = read_record(in.data(), in.data() + in.size(), adapter);
+  if (error) {
+    err = error;
+    return false;
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef JSTP_CPP_JSRS_HANDLER_H
+#define JSTP_CPP_JSRS_HANDLER_H
+
+#include "jsrs.h"
+
+#include <string>
+
+namespace jstp {
+
+/**
+ * Receiver of the values of a Record as they are parsed
+ *
+ * Every callback returns true to continue or false to stop parsing. The default ones
+ * ignore their values. Strings and keys are valid only during the call, escape sequences
+ * in strings are already decoded. Contents of an object come as on_key() followed by
+ * the callbacks of its value.
+ */
+class Handler {
+ public:
+  virtual ~Handler() { }
+
+  virtual bool on_undefined() { return true; }
+  virtual bool on_null() { return true; }
+  virtual bool on_bool(bool value) { return true; }
+  virtual bool on_number(double value) { return true; }
+  virtual bool on_string(StringRef value) { return true; }
+
+  virtual bool on_object_begin() { return true; }
+  virtual bool on_key(StringRef key) { return true; }
+  virtual bool on_object_end() { return true; }
+
+  virtual bool on_array_begin() { return true; }
+  virtual bool on_array_end() { return true; }
+};
+
+/**
+ * Parses in and reports its values to handler without building Records.
+ * Returns false and sets err if the input is malformed or the handler has stopped.
+ */
+bool parse(const std::string &in, Handler &handler, std::string &err);
+
+}
+
+#endif //JSTP_CPP_JSRS_HANDLER_H
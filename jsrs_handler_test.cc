@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_handler.h"
+
+// Writes every event down
+class EventLog : public jstp::Handler {
+ public:
+  std::string log;
+
+  bool on_undefined() { log += "u "; return true; }
+  bool on_null() { log += "n "; return true; }
+  bool on_bool(bool value) { log += value ? "t " : "f "; return true; }
+  bool on_number(double value) { log += jstp::Record(value).stringify() + " "; return true; }
+  bool on_string(jstp::StringRef value) { log += "'" + value.str() + "' "; return true; }
+  bool on_object_begin() { log += "{ "; return true; }
+  bool on_key(jstp::StringRef key) { log += key.str() + ": "; return true; }
+  bool on_object_end() { log += "} "; return true; }
+  bool on_array_begin() { log += "[ "; return true; }
+  bool on_array_end() { log += "] "; return true; }
+};
+
+// Takes one top level string field and stops
+class FieldFinder : public jstp::Handler {
+ public:
+  explicit FieldFinder(const std::string &name) : name(name), depth(0), found(false) { }
+
+  std::string value;
+
+  bool on_object_begin() { ++depth; return true; }
+  bool on_object_end() { --depth; return true; }
+  bool on_array_begin() { ++depth; return true; }
+  bool on_array_end() { --depth; return true; }
+  bool on_key(jstp::StringRef key) { found = depth == 1 && key == name; return true; }
+  bool on_string(jstp::StringRef str) {
+    if (found) {
+      value = str.str();
+    }
+    return !found;
+  }
+
+ private:
+  std::string name;
+  int depth;
+  bool found;
+};
+
+TEST(jsrs_handler_test, jsrs_handler_test_Events) {
+  EventLog handler;
+  std::string err = "";
+  EXPECT_TRUE(jstp::parse("{a:[1,,null,true],b:{c:'x\\ty'},d:undefined}", handler, err));
+  EXPECT_EQ("", err);
+  EXPECT_EQ("{ a: [ 1 u n t ] b: { c: 'x\ty' } d: u } ", handler.log);
+}
+
+TEST(jsrs_handler_test, jsrs_handler_test_Stop) {
+  FieldFinder handler("name");
+  std::string err = "";
+  EXPECT_FALSE(jstp::parse("{id:1,inner:{name:'no'},name:'Marcus',rest:[", handler, err));
+  EXPECT_EQ("Marcus", handler.value);
+  EXPECT_EQ("Parsing stopped by handler", err);
+}
+
+TEST(jsrs_handler_test, jsrs_handler_test_Validate) {
+  jstp::Handler handler;
+  for (auto &iterator : testData::validArray()) {
+    std::string err = "";
+    EXPECT_TRUE(jstp::parse(iterator, handler, err)) << iterator;
+  }
+  for (auto &iterator : testData::inValidArray()) {
+    std::string err = "";
+    EXPECT_FALSE(jstp::parse(iterator, handler, err)) << iterator;
+    EXPECT_NE("", err);
+  }
+}
@@ -0,0 +1,103 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_index.h"
+
+namespace jstp {
+
+// Indexes a string or skips a comment that starts at i, returns a pointer past it or nullptr on error
+static const char *index_quoted(const char *begin, const char *i, const char *end, std::vector<std::uint32_t> &index,
+                                const char *&error) {
+  if (*i == '/') {
+    i = skip_quoted(i, end);
+    return i ? i : end;  // An unterminated multiline comment extends to the end
+  }
+  const char *close = find_string_stop(i + 1, end, *i);
+  std::uint32_t escaped = 0;
+  while (close < end && *close == '\\') {
+    escaped = kEscapedString;
+    close = skip_escape(close, end);
+    if (!close) {
+      error = "Invalid escape sequence in string";
+      return nullptr;
+    }
+    close = find_string_stop(close, end, *i);
+  }
+  if (close >= end) {
+    error = "Error while parsing string";
+    return nullptr;
+  }
+  index.push_back(static_cast<std::uint32_t>(i - begin));
+  index.push_back(static_cast<std::uint32_t>(close - begin) | escaped);
+  return close + 1;
+}
+
+const char *build_index(const char *begin, const char *end, std::vector<std::uint32_t> &index) {
+  index.clear();
+  if (static_cast<std::size_t>(end - begin) > kIndexOffsetMask) {
+    return "Input is too large for a structural index";
+  }
+  index.reserve((end - begin) / 8);
+  const char *error = nullptr;
+  const char *i = begin;
+  // Every block is classified once, strings and comments that end inside of it only clear its stops
+  while (end - i >= kScanBlockSize) {
+    BlockClasses classes;
+    classify(i, classes);
+    std::uint32_t stops = classes.structural | classes.double_quote | classes.single_quote | classes.comment_start;
+    const char *next = i + kScanBlockSize;
+    while (stops) {
+      const unsigned bit = count_trailing_zeros(stops);
+      if (classes.structural & (std::uint32_t(1) << bit)) {
+        index.push_back(static_cast<std::uint32_t>(i + bit - begin));
+        stops &= stops - 1;
+        continue;
+      }
+      const char *after = index_quoted(begin, i + bit, end, index, error);
+      if (!after) {
+        return error;
+      }
+      if (after >= next) {
+        next = after;
+        break;
+      }
+      stops &= ~((std::uint32_t(1) << (after - i)) - 1);
+    }
+    i = next;
+  }
+  while ((i = find_token_stop(i, end)) < end) {
+    if (*i == '\"' || *i == '\'' || *i == '/') {
+      i = index_quoted(begin, i, end, index, error);
+      if (!i) {
+        return error;
+      }
+    } else {
+      index.push_back(static_cast<std::uint32_t>(i - begin));
+      ++i;
+    }
+  }
+  return nullptr;
+}
+
+}
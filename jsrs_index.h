@@ -0,0 +1,261 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Two-stage parser over a structural index of the input, not a part of the public interface
+
+#ifndef JSTP_CPP_JSRS_INDEX_H
+#define JSTP_CPP_JSRS_INDEX_H
+
+#include "jsrs_reader.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace jstp {
+
+// Set in the entry of a closing quote if the string has escape sequences
+const std::uint32_t kEscapedString = 0x80000000u;
+// Offsets of the index take the other bits
+const std::uint32_t kIndexOffsetMask = 0x7fffffffu;
+
+/**
+ * Stage 1: writes the offsets of all brackets, braces, commas and colons that are not inside
+ * of strings or comments to index, and the offsets of both quotes of every string. Escape sequences
+ * are checked on the way. Returns nullptr on success or an error message.
+ */
+const char *build_index(const char *begin, const char *end, std::vector<std::uint32_t> &index);
+
+/**
+ * Stage 2: lexer that walks the structural index and reports values to a handler
+ *
+ * The handler is the one of Reader. Strings are taken from the index without scanning them
+ * again, and scalars are parsed within the bounds of the next structural character.
+ */
+template <class Handler>
+class IndexReader {
+ public:
+  IndexReader(const char *begin, const char *end, const std::vector<std::uint32_t> &index, Handler &handler)
+      : begin(begin), end(end), index(index), cursor(0), handler(handler), error(nullptr) { }
+
+  /**
+   * Parses a Record that spans the whole input, returns nullptr on success or an error message
+   */
+  const char *read() {
+    const char *i = skip_spaces(begin, end);
+    Record::Type type;
+    if (!get_type(i, end, type)) {
+      return "Invalid type";
+    }
+    i = parse_value(i, type);
+    if (!i) {
+      return error;
+    }
+    if (skip_spaces(i, end) != end) {
+      return "Invalid format";
+    }
+    return nullptr;
+  }
+
+ private:
+  const char *fail(const char *message) {
+    if (!error) {
+      error = message;
+    }
+    return nullptr;
+  }
+
+  const char *position(std::size_t n) const { return begin + (index[n] & kIndexOffsetMask); }
+
+  // Returns the next structural character, no scalar extends past it
+  const char *bound() const { return cursor < index.size() ? position(cursor) : end; }
+
+  const char *parse_value(const char *i, Record::Type type) {
+    switch (type) {
+      case Record::UNDEFINED:
+        if (!handler.on_undefined()) {
+          return fail(kStoppedByHandler);
+        }
+        return (*i == 'u') ? i + 9 : i;  // Holes of arrays and objects take no characters
+      case Record::NUL:
+        return handler.on_null() ? i + 4 : fail(kStoppedByHandler);
+      case Record::BOOL:
+        return parse_bool(i);
+      case Record::NUMBER:
+        return parse_number(i);
+      case Record::STRING:
+        return parse_string(i);
+      case Record::ARRAY:
+        return parse_array(i);
+      case Record::OBJECT:
+        return parse_object(i);
+    }
+    return fail("Invalid type");
+  }
+
+  const char *parse_bool(const char *i) {
+    const std::size_t size = bound() - i;
+    bool value;
+    if (size >= 4 && std::strncmp(i, "true", 4) == 0) {
+      value = true;
+    } else if (size >= 5 && std::strncmp(i, "false", 5) == 0) {
+      value = false;
+    } else {
+      return fail("Invalid format: expected boolean");
+    }
+    return handler.on_bool(value) ? i + (value ? 4 : 5) : fail(kStoppedByHandler);
+  }
+
+  const char *parse_number(const char *i) {
+    double value;
+    std::size_t size = parse_double(i, bound(), value);
+    if (!size) {
+      return fail("Invalid format of number");
+    }
+    return handler.on_number(value) ? i + size : fail(kStoppedByHandler);
+  }
+
+  const char *parse_string(const char *i) {
+    // The opening quote is at the cursor, as nothing but whitespace and comments precedes the value
+    const std::uint32_t close = index[cursor + 1];
+    const char *string_end = begin + (close & kIndexOffsetMask);
+    cursor += 2;
+    if (!handler.on_string(i + 1, string_end - i - 1, (close & kEscapedString) != 0)) {
+      return fail(kStoppedByHandler);
+    }
+    return string_end + 1;
+  }
+
+  const char *parse_object(const char *i) {
+    Record::Type current_type;
+    ++cursor;
+    if (!handler.on_object_begin()) {
+      return fail(kStoppedByHandler);
+    }
+    i = skip_spaces(i + 1, end);
+    if (i < end && *i == '}') { // In case of empty object
+      ++cursor;
+      return handler.on_object_end() ? i + 1 : fail(kStoppedByHandler);
+    }
+    while (i < end) {
+      const char *colon = bound();
+      const char *key_end = skip_key_chars(i, colon);
+      StringRef key(i, key_end - i);
+      if (key.empty() || colon >= end || *colon != ':' || skip_spaces(key_end, colon) != colon) {
+        return fail("Invalid format in object: key is invalid");
+      }
+      ++cursor;
+      i = skip_spaces(colon + 1, end);
+      if (!get_type(i, end, current_type)) {
+        return fail("Invalid format in object");
+      }
+      if (!handler.on_key(key)) {
+        return fail(kStoppedByHandler);
+      }
+      i = parse_value(i, current_type);
+      if (!i) {
+        return nullptr;
+      }
+      i = skip_spaces(i, end);
+      if (i < end && *i == ',') {
+        ++cursor;
+        i = skip_spaces(i + 1, end);
+        if (i < end && *i == '}') { // Trailing comma
+          ++cursor;
+          return handler.on_object_end() ? i + 1 : fail(kStoppedByHandler);
+        }
+      } else if (i < end && *i == '}') {
+        ++cursor;
+        return handler.on_object_end() ? i + 1 : fail(kStoppedByHandler);
+      } else {
+        return fail("Invalid format in object: missed semicolon");
+      }
+    }
+    return fail("Invalid format in object: missed closing brace");
+  }
+
+  const char *parse_array(const char *i) {
+    Record::Type current_type;
+    ++cursor;
+    if (!handler.on_array_begin()) {
+      return fail(kStoppedByHandler);
+    }
+    i = skip_spaces(i + 1, end);
+    if (i < end && *i == ']') { // In case of empty array
+      ++cursor;
+      return handler.on_array_end() ? i + 1 : fail(kStoppedByHandler);
+    }
+    while (i < end) {
+      if (!get_type(i, end, current_type)) {
+        return fail("Invalid format in array");
+      }
+      i = parse_value(i, current_type);
+      if (!i) {
+        return nullptr;
+      }
+      i = skip_spaces(i, end);
+      if (i < end && *i == ',') {
+        ++cursor;
+        i = skip_spaces(i + 1, end);
+      } else if (i < end && *i == ']') {
+        ++cursor;
+        return handler.on_array_end() ? i + 1 : fail(kStoppedByHandler);
+      } else {
+        return fail("Invalid format in array: missed semicolon");
+      }
+    }
+    return fail("Invalid format in array: missed closing bracket");
+  }
+
+  const char *const begin;
+  const char *const end;
+  const std::vector<std::uint32_t> &index;
+  // Next entry of the index
+  std::size_t cursor;
+  Handler &handler;
+  const char *error;
+};
+
+/**
+ * Parses a Record that spans the whole input with both stages, returns nullptr on success or an error message
+ */
+template <class Handler>
+const char *read_indexed(const char *begin, const char *end, Handler &handler) {
+  JSTP_CPP_TIME(parse_ns);
+  JSTP_CPP_COUNT(pending_stats().bytes_parsed += end - begin);
+  std::vector<std::uint32_t> index;
+  const char *error;
+  {
+    JSTP_CPP_TIME(prepass_ns);
+    error = build_index(begin, end, index);
+  }
+  if (error) {
+    return error;
+  }
+  IndexReader<Handler> reader(begin, end, index, handler);
+  return reader.read();
+}
+
+}
+
+#endif //JSTP_CPP_JSRS_INDEX_H
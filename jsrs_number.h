@@ -0,0 +1,52 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+// Conversions between doubles and their text form, not a part of the public interface
+
+#ifndef JSTP_CPP_JSRS_NUMBER_H
+#define JSTP_CPP_JSRS_NUMBER_H
+
+#include <cstddef>
+
+namespace jstp {
+
+// Enough for any output of format_double()
+const std::size_t kMaxDoubleLength = 32;
+
+/**
+ * Writes a short text that parses back to the same value into buffer
+ * and returns its length. The notation is the one of JavaScript Number.prototype.toString,
+ * except that negative zero keeps its sign.
+ */
+std::size_t format_double(double value, char *buffer);
+
+/**
+ * Parses a number that starts at begin and returns the number of consumed characters,
+ * 0 if there is no number. Rounding is exact and does not depend on the locale.
+ */
+std::size_t parse_double(const char *begin, const char *end, double &value);
+
+}
+
+#endif //JSTP_CPP_JSRS_NUMBER_H
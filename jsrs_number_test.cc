@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include "jsrs_number.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+static std::string format(double value) {
+  char buffer[jstp::kMaxDoubleLength];
+  return std::string(buffer, jstp::format_double(value, buffer));
+}
+
+static double parse(const std::string &str) {
+  double value = 0;
+  EXPECT_EQ(str.size(), jstp::parse_double(str.data(), str.data() + str.size(), value)) << str;
+  return value;
+}
+
+TEST(jsrs_number_test, jsrs_number_test_Format) {
+  EXPECT_EQ("25.5", format(25.5));
+  EXPECT_EQ("0.1", format(0.1));
+  EXPECT_EQ("-0", format(-0.0));
+  EXPECT_EQ("0", format(0.0));
+  EXPECT_EQ("123456", format(123456));
+  EXPECT_EQ("0.000001", format(0.000001));
+  EXPECT_EQ("1e-7", format(1e-7));
+  EXPECT_EQ("123456789012345680000", format(123456789012345680000.0));
+  EXPECT_EQ("1e+21", format(1e21));
+  EXPECT_EQ("5e-324", format(5e-324));
+  EXPECT_EQ("1.7976931348623157e+308", format(1.7976931348623157e308));
+  EXPECT_EQ("-Infinity", format(-1.0 / 0.0));
+}
+
+TEST(jsrs_number_test, jsrs_number_test_Parse) {
+  EXPECT_EQ(42, parse("42"));
+  EXPECT_EQ(-0.5, parse("-.5"));
+  EXPECT_EQ(1250, parse("+12.5e2"));
+  EXPECT_EQ(0.1, parse("0.1"));
+  EXPECT_EQ(1e300, parse("1e300"));
+  EXPECT_EQ(0, parse("1e-400"));
+  EXPECT_EQ(1.0 / 0.0, parse("1e400"));
+  EXPECT_EQ(4.9406564584124654e-324, parse("4.9406564584124654e-324"));
+  EXPECT_EQ(9007199254740993.0, parse("9007199254740993"));
+  EXPECT_EQ(0.30000000000000004, parse("0.3000000000000000444089209850062616169452667236328125"));
+  double value;
+  std::string in = "12.5e3,";
+  EXPECT_EQ(6, jstp::parse_double(in.data(), in.data() + in.size(), value));
+  in = "1e]";
+  EXPECT_EQ(1, jstp::parse_double(in.data(), in.data() + in.size(), value));
+  in = "-.e1";
+  EXPECT_EQ(0, jstp::parse_double(in.data(), in.data() + in.size(), value));
+}
+
+TEST(jsrs_number_test, jsrs_number_test_RoundTrip) {
+  std::mt19937_64 random(42);
+  for (int i = 0; i < 200000; ++i) {
+    std::uint64_t bits = random();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0) {
+      continue;
+    }
+    std::string str = format(value);
+    double parsed = parse(str);
+    EXPECT_EQ(0, std::memcmp(&value, &parsed, sizeof(value))) << str;
+    EXPECT_EQ(std::strtod(str.c_str(), nullptr), parsed) << str;
+  }
+}
+
+TEST(jsrs_number_test, jsrs_number_test_ParseDecimals) {
+  std::mt19937_64 random(7);
+  for (int i = 0; i < 200000; ++i) {
+    std::string str = std::to_string(random() >> (random() % 64));
+    std::size_t digits = random() % 30;
+    for (std::size_t j = 0; j < digits; ++j) {
+      str += static_cast<char>('0' + random() % 10);
+    }
+    str.insert(random() % (str.size() + 1), ".");
+    str += "e" + std::to_string(static_cast<int>(random() % 700) - 350);
+    EXPECT_EQ(std::strtod(str.c_str(), nullptr), parse(str)) << str;
+  }
+}
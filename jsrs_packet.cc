@@ -0,0 +1,192 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_packet.h"
+#include "jsrs_reader.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace jstp {
+
+// PacketReader implementation
+
+const std::size_t PacketReader::kDefaultBufferSize;
+const std::size_t PacketReader::kDefaultMaxPacket;
+
+PacketReader::PacketReader(int fd, std::size_t buffer_size, std::size_t max_packet)
+    : fd(fd), max_packet(max_packet), buffer(buffer_size ? buffer_size : 1), start(0), filled(0), scanned(0),
+      closed(false) { }
+
+bool PacketReader::fill(std::string &err) {
+  if (start == filled) {
+    start = filled = scanned = 0;
+  } else if (filled == buffer.size()) {
+    if (start) {  // Move the unfinished packet to the front
+      std::memmove(buffer.data(), buffer.data() + start, filled - start);
+      filled -= start;
+      scanned -= start;
+      start = 0;
+    } else {
+      buffer.resize(buffer.size() * 2);
+    }
+  }
+  for (;;) {
+    const ssize_t count = ::read(fd, buffer.data() + filled, buffer.size() - filled);
+    if (count > 0) {
+      filled += count;
+      return true;
+    }
+    if (count == 0) {
+      closed = true;
+      if (start != filled) {
+        err = "Stream ended inside a packet";
+      }
+      return false;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return false;
+    }
+    if (errno != EINTR) {
+      err = std::string("Cannot read packets: ") + std::strerror(errno);
+      return false;
+    }
+  }
+}
+
+bool PacketReader::next_frame(StringRef &frame, std::string &err) {
+  for (;;) {
+    const char *terminator = static_cast<const char *>(
+        std::memchr(buffer.data() + scanned, '\0', filled - scanned));
+    if (terminator) {
+      const std::size_t end = terminator - buffer.data();
+      frame = StringRef(buffer.data() + start, end - start);
+      start = scanned = end + 1;
+      return true;
+    }
+    scanned = filled;
+    if (filled - start > max_packet) {
+      err = "Packet is too large";
+      return false;
+    }
+    if (closed || !fill(err)) {
+      return false;
+    }
+  }
+}
+
+bool PacketReader::next(ParseResult &packet, std::string &err) {
+  StringRef frame;
+  if (!next_frame(frame, err)) {
+    return false;
+  }
+  RecordBuilder builder(nullptr, &KeyPool::local(), false);
+  const char *error = read_record(frame.data(), frame.data() + frame.size(), builder);
+  if (error) {
+    packet.record = Record();
+    packet.error = error;
+  } else {
+    packet.record = builder.result();
+    packet.error.clear();
+  }
+  return true;
+}
+
+// end of PacketReader implementation
+
+// PacketWriter implementation
+
+const std::size_t PacketWriter::kExternal;
+
+void PacketWriter::write(const Record &record) {
+  if (used == buffers.size()) {
+    buffers.emplace_back();
+  }
+  std::string &out = buffers[used];
+  out.clear();
+  record.stringify(out);
+  packets.push_back(Packet{used++, StringRef()});
+}
+
+void PacketWriter::write(StringRef packet) {
+  packets.push_back(Packet{kExternal, packet});
+}
+
+StringRef PacketWriter::data(const Packet &packet) const {
+  return packet.index == kExternal ? packet.external : StringRef(buffers[packet.index]);
+}
+
+bool PacketWriter::flush(std::string &err) {
+  static char terminator = '\0';
+  const std::size_t kMaxVectors = IOV_MAX < 1024 ? IOV_MAX : 1024;
+  iovec vectors[kMaxVectors];
+  while (first < packets.size()) {
+    std::size_t count = 0;
+    std::size_t skip = offset;
+    for (std::size_t i = first; i < packets.size() && count + 2 <= kMaxVectors; ++i, skip = 0) {
+      const StringRef chars = data(packets[i]);
+      if (skip < chars.size()) {
+        vectors[count].iov_base = const_cast<char *>(chars.data() + skip);
+        vectors[count].iov_len = chars.size() - skip;
+        ++count;
+      }
+      vectors[count].iov_base = &terminator;
+      vectors[count].iov_len = 1;
+      ++count;
+    }
+    ssize_t sent = ::writev(fd, vectors, static_cast<int>(count));
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        err = std::string("Cannot write packets: ") + std::strerror(errno);
+      }
+      return false;
+    }
+    while (sent > 0) {
+      const std::size_t left = data(packets[first]).size() + 1 - offset;
+      if (static_cast<std::size_t>(sent) < left) {
+        offset += sent;
+        break;
+      }
+      sent -= left;
+      ++first;
+      offset = 0;
+    }
+  }
+  packets.clear();
+  used = 0;
+  first = 0;
+  offset = 0;
+  return true;
+}
+
+// end of PacketWriter implementation
+
+}
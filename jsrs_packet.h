@@ -0,0 +1,137 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JSTP_CPP_JSRS_PACKET_H
+#define JSTP_CPP_JSRS_PACKET_H
+
+#include "jsrs.h"
+#include "jsrs_batch.h"
+
+#include <string>
+#include <vector>
+
+namespace jstp {
+
+/**
+ * Reader of '\0' terminated packets from a stream file descriptor, e.g. a socket
+ *
+ * Data is received into one buffer that is reused for all the packets, frames are found in place
+ * and parsed from it without copying. The buffer grows to fit a packet up to max_packet bytes.
+ * The reader does not own the descriptor. On a non-blocking descriptor next() returns false
+ * with an empty error and eof() unset when no complete packet is available yet.
+ */
+class PacketReader {
+ public:
+  static const std::size_t kDefaultBufferSize = 64 * 1024;
+  static const std::size_t kDefaultMaxPacket = 64 * 1024 * 1024;
+
+  explicit PacketReader(int fd, std::size_t buffer_size = kDefaultBufferSize,
+                        std::size_t max_packet = kDefaultMaxPacket);
+
+  /**
+   * Returns the next packet without its terminator, it refers to the buffer and is valid until
+   * the next call. Returns false at the end of the stream or on an error, then err is set
+   * unless the stream has ended after a complete packet or the descriptor would block.
+   */
+  bool next_frame(StringRef &frame, std::string &err);
+
+  /**
+   * Parses the next packet, a malformed one is returned with its error and the stream goes on.
+   * Keys of objects are taken from the pool of the calling thread.
+   */
+  bool next(ParseResult &packet, std::string &err);
+
+  bool eof() const { return closed; }
+
+ private:
+  // Reads once from the descriptor past the data in the buffer
+  bool fill(std::string &err);
+
+  const int fd;
+  const std::size_t max_packet;
+  std::vector<char> buffer;
+  // Data that is received but not returned yet is between start and filled
+  std::size_t start;
+  std::size_t filled;
+  // Position up to which the data has no terminators
+  std::size_t scanned;
+  bool closed;
+};
+
+/**
+ * Writer of '\0' terminated packets to a stream file descriptor
+ *
+ * Packets are queued and are sent by flush() with as few writev() calls as possible.
+ * Strings of the serialized records are reused by the following packets.
+ * The writer does not own the descriptor.
+ */
+class PacketWriter {
+ public:
+  explicit PacketWriter(int fd) : fd(fd), used(0), first(0), offset(0) { }
+
+  /**
+   * Queues the serialization of record
+   */
+  void write(const Record &record);
+
+  /**
+   * Queues a packet without copying it, the characters must be kept until it is flushed
+   */
+  void write(StringRef packet);
+
+  /**
+   * Sends the queued packets, returns false on an error and sets err. On a non-blocking descriptor
+   * it returns false with an empty error if the descriptor would block, the rest is sent by the next call.
+   */
+  bool flush(std::string &err);
+
+  std::size_t pending() const { return packets.size() - first; }
+
+ private:
+  /**
+   * Packet that is the string of buffers at index, or the external characters if index is kExternal
+   */
+  struct Packet {
+    std::size_t index;
+    StringRef external;
+  };
+
+  static const std::size_t kExternal = static_cast<std::size_t>(-1);
+
+  StringRef data(const Packet &packet) const;
+
+  const int fd;
+  std::vector<std::string> buffers;
+  // Number of buffers in use
+  std::size_t used;
+  std::vector<Packet> packets;
+  // The first packet that is not sent completely and the number of its bytes that are sent,
+  // the terminator counts as a byte
+  std::size_t first;
+  std::size_t offset;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_PACKET_H
@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_packet.h"
+
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST(jsrs_packet_test, jsrs_packet_test_RoundTrip) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  const std::string raw = "{raw:true}";
+  const std::string number(100000, '1');
+  std::thread sender([&] {
+    jstp::PacketWriter writer(fds[0]);
+    std::string err;
+    for (int i = 0; i < 10000; ++i) {
+      jstp::Record record = jstp::Record::parse("{id:0,name:'packet',tags:['a','b']}", err);
+      record.set("id", jstp::Record(static_cast<double>(i)));
+      writer.write(record);
+      if (i % 1000 == 999) {
+        writer.write(jstp::StringRef(raw));
+        EXPECT_TRUE(writer.flush(err));
+        EXPECT_EQ(0u, writer.pending());
+      }
+    }
+    writer.write(jstp::StringRef("{id:"));  // Malformed
+    writer.write(jstp::StringRef(number));
+    EXPECT_TRUE(writer.flush(err));
+    EXPECT_EQ("", err);
+    close(fds[0]);
+  });
+
+  jstp::PacketReader reader(fds[1], 1024);
+  jstp::ParseResult packet;
+  std::string err;
+  int records = 0;
+  int raws = 0;
+  while (records < 10000 && reader.next(packet, err)) {
+    ASSERT_TRUE(packet.ok());
+    if (packet.record["raw"].bool_value()) {
+      ++raws;
+    } else {
+      EXPECT_EQ(records, packet.record["id"].number_value());
+      EXPECT_EQ("b", packet.record["tags"][1].string_value());
+      ++records;
+    }
+  }
+  EXPECT_EQ(10000, records);
+  EXPECT_TRUE(reader.next(packet, err));
+  EXPECT_TRUE(packet.record["raw"].bool_value());
+  EXPECT_TRUE(reader.next(packet, err));
+  EXPECT_FALSE(packet.ok());
+  EXPECT_TRUE(reader.next(packet, err));
+  EXPECT_TRUE(packet.ok());
+  EXPECT_EQ(jstp::Record::NUMBER, packet.record.type());
+  EXPECT_FALSE(reader.next(packet, err));
+  EXPECT_EQ("", err);
+  EXPECT_TRUE(reader.eof());
+  sender.join();
+  close(fds[1]);
+}
+
+TEST(jsrs_packet_test, jsrs_packet_test_Frames) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  const std::string stream = std::string("first\0\0third packet\0unfinished", 30);
+  std::thread sender([&] {
+    for (char c : stream) {  // Frames are split across reads
+      EXPECT_EQ(1, write(fds[0], &c, 1));
+    }
+    close(fds[0]);
+  });
+
+  jstp::PacketReader reader(fds[1], 4);
+  jstp::StringRef frame;
+  std::string err;
+  ASSERT_TRUE(reader.next_frame(frame, err));
+  EXPECT_EQ("first", frame.str());
+  ASSERT_TRUE(reader.next_frame(frame, err));
+  EXPECT_EQ("", frame.str());
+  ASSERT_TRUE(reader.next_frame(frame, err));
+  EXPECT_EQ("third packet", frame.str());
+  EXPECT_FALSE(reader.next_frame(frame, err));
+  EXPECT_EQ("Stream ended inside a packet", err);
+  sender.join();
+  close(fds[1]);
+}
+
+TEST(jsrs_packet_test, jsrs_packet_test_Limits) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  jstp::PacketReader reader(fds[1], 16, 64);
+  jstp::StringRef frame;
+  std::string err;
+  EXPECT_FALSE(reader.next_frame(frame, err));
+  EXPECT_EQ("", err);
+  EXPECT_FALSE(reader.eof());
+
+  const std::string large(100, 'x');
+  EXPECT_EQ(100, write(fds[0], large.data(), large.size()));
+  EXPECT_FALSE(reader.next_frame(frame, err));
+  EXPECT_EQ("Packet is too large", err);
+  close(fds[0]);
+  close(fds[1]);
+}
@@ -0,0 +1,515 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_query.h"
+#include "jsrs_reader.h"
+#include "jsrs_scan.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+namespace jstp {
+
+const std::size_t kNoNode = static_cast<std::size_t>(-1);
+
+Query::Node::Node() : any(kNoNode) { }
+
+// FNV-1a over the characters of a key
+struct KeyHash {
+  std::size_t operator()(const StringRef &key) const {
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < key.size(); ++i) {
+      hash = (hash ^ static_cast<unsigned char>(key.data()[i])) * 16777619u;
+    }
+    return hash;
+  }
+};
+
+/**
+ * Handler of a selective Reader that runs a Query
+ *
+ * Containers are entered only while they may hold selected values, selected values are
+ * built by a RecordBuilder. Each selected value is given to the paths that end at it and is
+ * walked for the paths that go deeper, it is added to the pruned copy of the input as well
+ * if a projection is built. As in a parsed Record, a key that repeats in an object discards
+ * whatever was selected under its earlier occurrences.
+ */
+class QueryRunner {
+ public:
+  QueryRunner(const std::vector<Query::Node> &nodes, std::vector<std::pair<std::size_t, Record>> *matches)
+      : nodes(nodes), matches(matches), depth(0), located(false), capture_depth(0),
+        builder(nullptr, nullptr, false) { }
+
+  bool skip(Record::Type type) {
+    if (capture_depth) {
+      return false;
+    }
+    locate();
+    return next.empty();
+  }
+
+  bool on_skipped(Record::Type type, const char *begin, const char *end) {
+    located = false;
+    advance();
+    return true;
+  }
+
+  bool on_undefined() {
+    if (capture_depth) {
+      return builder.on_undefined();
+    }
+    if (take_next()) {
+      deliver(Record());
+    }
+    return true;
+  }
+
+  bool on_null() {
+    if (capture_depth) {
+      return builder.on_null();
+    }
+    if (take_next()) {
+      deliver(Record(nullptr));
+    }
+    return true;
+  }
+
+  bool on_bool(bool value) {
+    if (capture_depth) {
+      return builder.on_bool(value);
+    }
+    if (take_next()) {
+      deliver(Record(value));
+    }
+    return true;
+  }
+
+  bool on_number(double value) {
+    if (capture_depth) {
+      return builder.on_number(value);
+    }
+    if (take_next()) {
+      deliver(Record(value));
+    }
+    return true;
+  }
+
+  bool on_string(const char *data, std::size_t length, bool escaped) {
+    if (capture_depth) {
+      return builder.on_string(data, length, escaped);
+    }
+    if (take_next()) {
+      deliver(Record::from_source(data, length, escaped, nullptr, false));
+    }
+    return true;
+  }
+
+  bool on_object_begin() { return begin_container(true); }
+
+  bool on_key(StringRef key) {
+    if (capture_depth) {
+      return builder.on_key(key);
+    }
+    Frame &top = *frames[depth - 1];
+    top.key = key;
+    top.first_match = matches ? matches->size() : 0;
+    top.added = false;
+    return true;
+  }
+
+  bool on_object_end() { return end_container(true); }
+
+  bool on_array_begin() { return begin_container(false); }
+
+  bool on_array_end() { return end_container(false); }
+
+  // Pruned copy of the input, if it was requested
+  Record projection;
+
+ private:
+  struct Frame {
+    bool is_object;
+    std::size_t index;               // Of the current item of an array
+    StringRef key;                   // Of the current value of an object
+    std::size_t first_match;         // Position in matches where the current value of an object begins
+    bool added;                      // Whether the current value of an object is in the projection
+    std::vector<std::size_t> nodes;  // Matched by the container
+    Record::array items;             // Kept by the projection
+    Record::object values;
+    // Positions in matches of the values given by the keys of an object, for discarding duplicates
+    std::unordered_map<StringRef, std::pair<std::size_t, std::size_t>, KeyHash> keys;
+  };
+
+  // Finds the nodes that the current value of the innermost container matches
+  void locate() {
+    next.clear();
+    located = true;
+    if (!depth) {
+      next.push_back(0);
+      return;
+    }
+    const Frame &top = *frames[depth - 1];
+    for (auto i = top.nodes.begin(); i != top.nodes.end(); ++i) {
+      const Query::Node &node = nodes[*i];
+      if (node.any != kNoNode) {
+        next.push_back(node.any);
+      }
+      if (top.is_object) {
+        for (auto j = node.keys.begin(); j != node.keys.end(); ++j) {
+          if (top.key == j->first) {
+            next.push_back(j->second);
+          }
+        }
+      } else {
+        for (auto j = node.indexes.begin(); j != node.indexes.end(); ++j) {
+          if (top.index == j->first) {
+            next.push_back(j->second);
+          }
+        }
+      }
+    }
+  }
+
+  bool is_selected() const {
+    for (auto i = next.begin(); i != next.end(); ++i) {
+      if (!nodes[*i].selects.empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns true if the current scalar is selected, skips it otherwise
+  bool take_next() {
+    if (!located) {
+      locate();
+    }
+    located = false;
+    if (is_selected()) {
+      captured.swap(next);
+      return true;
+    }
+    advance();
+    return false;
+  }
+
+  bool begin_container(bool is_object) {
+    if (capture_depth) {
+      ++capture_depth;
+      return is_object ? builder.on_object_begin() : builder.on_array_begin();
+    }
+    if (!located) {
+      locate();
+    }
+    located = false;
+    if (is_selected()) {
+      captured.swap(next);
+      capture_depth = 1;
+      return is_object ? builder.on_object_begin() : builder.on_array_begin();
+    }
+    if (depth == frames.size()) {
+      frames.emplace_back(new Frame());
+    }
+    Frame &frame = *frames[depth++];
+    frame.is_object = is_object;
+    frame.index = 0;
+    frame.keys.clear();
+    frame.nodes.swap(next);
+    return true;
+  }
+
+  bool end_container(bool is_object) {
+    if (capture_depth) {
+      bool result = is_object ? builder.on_object_end() : builder.on_array_end();
+      if (--capture_depth == 0) {
+        Record value = builder.result();
+        builder.clear();
+        deliver(std::move(value));
+      }
+      return result;
+    }
+    Frame &frame = *frames[--depth];
+    if (!matches) {
+      Record value;
+      bool empty;
+      if (is_object) {
+        empty = frame.values.empty();
+        value = Record(std::move(frame.values));
+        frame.values.clear();
+      } else {
+        empty = frame.items.empty();
+        value = Record(std::move(frame.items));
+        frame.items.clear();
+      }
+      if (!depth || !empty) {  // The root is kept even if nothing is selected
+        add(std::move(value));
+      }
+    }
+    advance();
+    return true;
+  }
+
+  void deliver(Record &&value) {
+    if (matches) {
+      for (auto i = captured.begin(); i != captured.end(); ++i) {
+        walk(value, *i);
+      }
+    } else {
+      add(std::move(value));
+    }
+    advance();
+  }
+
+  // Adds a value to the projection
+  void add(Record &&value) {
+    if (!depth) {
+      projection = std::move(value);
+      return;
+    }
+    Frame &top = *frames[depth - 1];
+    if (top.is_object) {
+      top.values[Key(top.key)] = std::move(value);  // Replaces an earlier duplicate in its place, as in parse()
+      top.added = true;
+    } else {
+      top.items.push_back(std::move(value));
+    }
+  }
+
+  // Gives value to the paths that end at node and walks it for the ones that go deeper
+  void walk(const Record &value, std::size_t node) {
+    const Query::Node &step = nodes[node];
+    for (auto i = step.selects.begin(); i != step.selects.end(); ++i) {
+      matches->emplace_back(*i, value);
+    }
+    if (value.is_object()) {
+      const Record::object &values = value.object_items();
+      for (auto i = values.begin(); i != values.end(); ++i) {
+        if (step.any != kNoNode) {
+          walk(i->second, step.any);
+        }
+        for (auto j = step.keys.begin(); j != step.keys.end(); ++j) {
+          if (i->first.ref() == j->first) {
+            walk(i->second, j->second);
+          }
+        }
+      }
+    } else if (value.is_array()) {
+      const Record::array &items = value.array_items();
+      for (std::size_t i = 0; i < items.size(); ++i) {
+        if (step.any != kNoNode) {
+          walk(items[i], step.any);
+        }
+        for (auto j = step.indexes.begin(); j != step.indexes.end(); ++j) {
+          if (i == j->first) {
+            walk(items[i], j->second);
+          }
+        }
+      }
+    }
+  }
+
+  // Moves past the current value of the innermost container
+  void advance() {
+    if (!depth) {
+      return;
+    }
+    Frame &top = *frames[depth - 1];
+    ++top.index;
+    if (!top.is_object) {
+      return;
+    }
+    if (!matches) {
+      if (!top.added && !top.values.empty()) {  // A later duplicate without selections still replaces
+        top.values.erase(top.key);
+      }
+      return;
+    }
+    const std::size_t last_match = matches->size();
+    if (top.keys.empty() && last_match == top.first_match) {
+      return;
+    }
+    auto earlier = top.keys.find(top.key);
+    if (earlier != top.keys.end()) {
+      for (std::size_t i = earlier->second.first; i < earlier->second.second; ++i) {
+        (*matches)[i].first = kNoNode;
+      }
+      top.keys.erase(earlier);
+    }
+    if (last_match != top.first_match) {
+      top.keys.emplace(top.key, std::make_pair(top.first_match, last_match));
+    }
+  }
+
+  const std::vector<Query::Node> &nodes;
+  // Selected values with the numbers of their paths in the order of the input, nullptr if a projection
+  // is built. Values under a repeated key are discarded by setting their numbers to kNoNode
+  std::vector<std::pair<std::size_t, Record>> *const matches;
+  // Frames are reused, only the first depth are in use
+  std::vector<std::unique_ptr<Frame>> frames;
+  std::size_t depth;
+  // Nodes matched by the current value, valid if located is set
+  std::vector<std::size_t> next;
+  bool located;
+  // Nodes matched by the value being built
+  std::vector<std::size_t> captured;
+  std::size_t capture_depth;
+  RecordBuilder builder;
+};
+
+bool Query::compile(const std::vector<std::string> &paths, std::string &err) {
+  nodes.assign(1, Node());
+  multiple.assign(paths.size(), false);
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    if (!add_path(paths[i], i, err)) {
+      nodes.assign(1, Node());
+      multiple.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Query::select(const std::string &in, std::vector<Record> &out, std::string &err) const {
+  std::vector<std::pair<std::size_t, Record>> matches;
+  QueryRunner runner(nodes, &matches);
+  const char *error = read_record<QueryRunner, true>(in.data(), in.data() + in.size(), runner);
+  if (error) {
+    err = error;
+    return false;
+  }
+  std::vector<Record::array> values(multiple.size());
+  for (auto i = matches.begin(); i != matches.end(); ++i) {
+    if (i->first != kNoNode) {
+      values[i->first].push_back(std::move(i->second));
+    }
+  }
+  out.clear();
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (multiple[i]) {
+      out.push_back(Record(std::move(values[i])));
+    } else {  // Duplicates are discarded, so a path without wildcards has at most one value
+      out.push_back(values[i].empty() ? Record() : std::move(values[i].back()));
+    }
+  }
+  return true;
+}
+
+Record Query::project(const std::string &in, std::string &err) const {
+  QueryRunner runner(nodes, nullptr);
+  const char *error = read_record<QueryRunner, true>(in.data(), in.data() + in.size(), runner);
+  if (error) {
+    err = error;
+    return Record();
+  }
+  return runner.projection;
+}
+
+bool Query::add_path(const std::string &path, std::size_t number, std::string &err) {
+  const char *i = path.data();
+  const char *end = i + path.size();
+  std::size_t node = 0;
+  if (i == end) {
+    err = "Invalid path: empty";
+    return false;
+  }
+  do {
+    if (*i == '[') {
+      ++i;
+      if (i < end && *i == '*') {
+        ++i;
+        node = add_any(node);
+        multiple[number] = true;
+      } else {
+        const char *digits = i;
+        std::size_t index = 0;
+        while (i < end && *i >= '0' && *i <= '9') {
+          index = index * 10 + (*i++ - '0');
+        }
+        if (i == digits) {
+          err = "Invalid path: expected index in " + path;
+          return false;
+        }
+        node = add_index(node, index);
+      }
+      if (i >= end || *i != ']') {
+        err = "Invalid path: missed closing bracket in " + path;
+        return false;
+      }
+      ++i;
+    } else {
+      if (node && *i++ != '.') {
+        err = "Invalid path: expected '.' or '[' in " + path;
+        return false;
+      }
+      if (i < end && *i == '*') {
+        ++i;
+        node = add_any(node);
+        multiple[number] = true;
+      } else {
+        const char *key = i;
+        i = skip_key_chars(i, end);
+        if (i == key) {
+          err = "Invalid path: expected key in " + path;
+          return false;
+        }
+        node = add_key(node, std::string(key, i));
+      }
+    }
+  } while (i < end);
+  nodes[node].selects.push_back(number);
+  return true;
+}
+
+std::size_t Query::add_key(std::size_t from, const std::string &key) {
+  for (auto i = nodes[from].keys.begin(); i != nodes[from].keys.end(); ++i) {
+    if (i->first == key) {
+      return i->second;
+    }
+  }
+  nodes.push_back(Node());
+  nodes[from].keys.push_back(std::make_pair(key, nodes.size() - 1));
+  return nodes.size() - 1;
+}
+
+std::size_t Query::add_index(std::size_t from, std::size_t index) {
+  for (auto i = nodes[from].indexes.begin(); i != nodes[from].indexes.end(); ++i) {
+    if (i->first == index) {
+      return i->second;
+    }
+  }
+  nodes.push_back(Node());
+  nodes[from].indexes.push_back(std::make_pair(index, nodes.size() - 1));
+  return nodes.size() - 1;
+}
+
+std::size_t Query::add_any(std::size_t from) {
+  if (nodes[from].any == kNoNode) {
+    nodes.push_back(Node());
+    nodes[from].any = nodes.size() - 1;
+  }
+  return nodes[from].any;
+}
+
+}
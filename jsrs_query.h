@@ -0,0 +1,99 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef JSTP_CPP_JSRS_QUERY_H
+#define JSTP_CPP_JSRS_QUERY_H
+
+#include "jsrs.h"
+
+#include <string>
+#include <vector>
+
+namespace jstp {
+
+/**
+ * Set of paths that is compiled once and applied to many inputs
+ *
+ * A path is a chain of keys and indexes such as "person.address.city" or "items[0].id",
+ * where "*" or "[*]" stand for any key of an object or any item of an array. Arrays and objects
+ * that cannot contain a selected value are skipped by brackets without being parsed or validated,
+ * and no Records are built for them.
+ */
+class Query {
+ public:
+  Query() : nodes(1) { }
+
+  /**
+   * Compiles paths replacing the previous ones, returns false and sets err
+   * if one of them is malformed
+   */
+  bool compile(const std::vector<std::string> &paths, std::string &err);
+
+  /**
+   * Returns the number of compiled paths
+   */
+  std::size_t size() const { return multiple.size(); }
+
+  /**
+   * Parses in and places the value of every path to out, in the order of paths.
+   * A path without wildcards gives its value or UNDEFINED, one with them gives an array
+   * of all the matches.
+   */
+  bool select(const std::string &in, std::vector<Record> &out, std::string &err) const;
+
+  /**
+   * Parses in and returns a Record that keeps only the selected values and the containers
+   * leading to them. Arrays keep only the items with selections, in their order.
+   */
+  Record project(const std::string &in, std::string &err) const;
+
+ private:
+  friend class QueryRunner;
+
+  /**
+   * Step of the compiled paths, paths with common prefixes share their steps
+   */
+  struct Node {
+    std::vector<std::pair<std::string, std::size_t>> keys;     // Next node for a key
+    std::vector<std::pair<std::size_t, std::size_t>> indexes;  // Next node for an index
+    std::size_t any;                                           // Next node for any key or index
+    std::vector<std::size_t> selects;                          // Numbers of paths that end here
+
+    Node();
+  };
+
+  bool add_path(const std::string &path, std::size_t number, std::string &err);
+  std::size_t add_key(std::size_t from, const std::string &key);
+  std::size_t add_index(std::size_t from, std::size_t index);
+  std::size_t add_any(std::size_t from);
+
+  // The first one is the root
+  std::vector<Node> nodes;
+  // Whether a path has wildcards, for every path
+  std::vector<bool> multiple;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_QUERY_H
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_query.h"
+
+static const std::string kPerson =
+    "{name:\"Marcus\",age:1940,"
+    "address:{country:'Ukraine',city:'Kiev',geo:[50.45,30.52]},"
+    "items:[{id:1,tags:['a']},{id:2,note:'x'},{name:'none'},{id:'3'}],"
+    "skipped:{deep:[[[{}]]],str:'}]'}}";
+
+TEST(jsrs_query_test, jsrs_query_test_Select) {
+  jstp::Query query;
+  std::string err = "";
+  ASSERT_TRUE(query.compile({"name", "address.city", "address.geo[1]", "items[*].id",
+                             "items[1]", "missing.key", "address.*"}, err));
+  EXPECT_EQ(7, query.size());
+  std::vector<jstp::Record> out;
+  ASSERT_TRUE(query.select(kPerson, out, err));
+  EXPECT_EQ("", err);
+  ASSERT_EQ(7, out.size());
+  EXPECT_EQ("\"Marcus\"", out[0].stringify());
+  EXPECT_EQ("\"Kiev\"", out[1].stringify());
+  EXPECT_EQ("30.52", out[2].stringify());
+  EXPECT_EQ("[1,2,\"3\"]", out[3].stringify());
+  EXPECT_EQ("{id:2,note:\"x\"}", out[4].stringify());
+  EXPECT_TRUE(out[5].is_undefined());
+  EXPECT_EQ("[\"Ukraine\",\"Kiev\",[50.45,30.52]]", out[6].stringify());
+
+  // Paths inside a selected value are walked in the built Record
+  ASSERT_TRUE(query.compile({"items[0]", "items[0].tags[0]"}, err));
+  ASSERT_TRUE(query.select(kPerson, out, err));
+  ASSERT_EQ(2, out.size());
+  EXPECT_EQ("{id:1,tags:[\"a\"]}", out[0].stringify());
+  EXPECT_EQ("\"a\"", out[1].stringify());
+}
+
+TEST(jsrs_query_test, jsrs_query_test_Project) {
+  jstp::Query query;
+  std::string err = "";
+  ASSERT_TRUE(query.compile({"name", "address.city", "items[*].id"}, err));
+  jstp::Record record = query.project(kPerson, err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ("{name:\"Marcus\",address:{city:\"Kiev\"},items:[{id:1},{id:2},{id:\"3\"}]}",
+            record.stringify());
+
+  ASSERT_TRUE(query.compile({"nothing"}, err));
+  EXPECT_EQ("{}", query.project(kPerson, err).stringify());
+  EXPECT_TRUE(query.project("42", err).is_undefined());
+}
+
+TEST(jsrs_query_test, jsrs_query_test_Errors) {
+  jstp::Query query;
+  std::string err = "";
+  EXPECT_FALSE(query.compile({""}, err));
+  EXPECT_FALSE(query.compile({"a..b"}, err));
+  EXPECT_FALSE(query.compile({"a[x]"}, err));
+  EXPECT_FALSE(query.compile({"a[1"}, err));
+  EXPECT_FALSE(query.compile({"a b"}, err));
+  EXPECT_EQ("Invalid path: expected '.' or '[' in a b", err);
+  EXPECT_EQ(0, query.size());
+
+  // Skipped subtrees are only balanced, the selected ones are fully checked
+  ASSERT_TRUE(query.compile({"a"}, err));
+  std::vector<jstp::Record> out;
+  EXPECT_TRUE(query.select("{b:[1 2 3],a:1}", out, err));
+  EXPECT_EQ("1", out[0].stringify());
+  EXPECT_FALSE(query.select("{a:[1 2 3]}", out, err));
+  EXPECT_FALSE(query.select("{b:[1,2,a:1}", out, err));
+}
+
+TEST(jsrs_query_test, jsrs_query_test_Duplicates) {
+  // Later duplicates replace the earlier ones with everything under them, as in Record::parse
+  const std::vector<std::string> inputs = {"{a:{b:1},a:{c:2}}", "{a:{b:1},x:0,a:{b:2}}", "{a:{b:1},a:3}",
+                                           "{a:[{b:1}],a:[{c:2}]}", "{x:{a:{b:1}},x:{a:{b:2},a:{}}}"};
+  jstp::Query query;
+  std::string err = "";
+  ASSERT_TRUE(query.compile({"a.b", "a[0].b", "x.a.b", "a.*"}, err));
+  for (const std::string &input : inputs) {
+    jstp::Record parsed = jstp::Record::parse(input, err);
+    std::vector<jstp::Record> out;
+    ASSERT_TRUE(query.select(input, out, err));
+    EXPECT_EQ(parsed["a"]["b"], out[0]) << input;
+    EXPECT_EQ(parsed["a"][0]["b"], out[1]) << input;
+    EXPECT_EQ(parsed["x"]["a"]["b"], out[2]) << input;
+    const std::size_t count = parsed["a"].is_object() ? parsed["a"].object_items().size()
+                                                      : parsed["a"].array_items().size();
+    EXPECT_EQ(count, out[3].array_items().size()) << input;
+  }
+
+  ASSERT_TRUE(query.compile({"a.b", "x.a.b"}, err));
+  EXPECT_EQ("{}", query.project("{a:{b:1},a:{c:2}}", err).stringify());
+  EXPECT_EQ("{a:{b:2},x:{a:{b:3}}}", query.project("{a:{b:1},x:{a:{b:3}},a:{b:2}}", err).stringify());
+  EXPECT_EQ("{}", query.project("{x:{a:{b:1},a:{}}}", err).stringify());
+}
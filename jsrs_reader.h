@@ -0,0 +1,463 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+// Lexer of the Record grammar that reports values to a handler, not a part of the public interface
+
+#ifndef JSTP_CPP_JSRS_READER_H
+#define JSTP_CPP_JSRS_READER_H
+
+#include "jsrs.h"
+#include "jsrs_number.h"
+#include "jsrs_scan.h"
+#include "jsrs_stats.h"
+#include "jsrs_string.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace jstp {
+
+/**
+ * Skips whitespace and comments, returns a pointer to the first significant character
+ * or end if there is none. An unterminated multiline comment extends to the end.
+ */
+inline const char *skip_spaces(const char *begin, const char *end) {
+  while (begin < end) {
+    if (is_space(*begin)) {
+      begin = skip_whitespace(begin + 1, end);
+    } else if (*begin == '/' && begin + 1 < end && begin[1] == '/') {
+      begin += 2;
+      while (begin < end && *begin != '\n' && *begin != '\r') ++begin;
+    } else if (*begin == '/' && begin + 1 < end && begin[1] == '*') {
+      const char *star = begin + 2;
+      while ((star = static_cast<const char *>(std::memchr(star, '*', end - star))) && star + 1 < end
+          && star[1] != '/') {
+        ++star;
+      }
+      begin = (star && star + 1 < end) ? star + 2 : end;
+    } else {
+      break;
+    }
+  }
+  return begin;
+}
+
+/**
+ * Tells the type of the value that starts at begin, returns false if there is no valid one
+ */
+inline bool get_type(const char *begin, const char *end, Record::Type &type) {
+  bool result = true;
+  if (begin >= end) {
+    return false;
+  }
+  switch (*begin) {
+    case ',':
+    case ']':
+      type = Record::Type::UNDEFINED;
+      break;
+    case '{':
+      type = Record::Type::OBJECT;
+      break;
+    case '[':
+      type = Record::Type::ARRAY;
+      break;
+    case '\"':
+    case '\'':
+      type = Record::Type::STRING;
+      break;
+    case 't':
+    case 'f':
+      type = Record::Type::BOOL;
+      break;
+    case 'n':
+      type = Record::Type::NUL;
+      result = begin + 4 <= end && std::strncmp(begin, "null", 4) == 0;
+      break;
+    case 'u':
+      type = Record::Type::UNDEFINED;
+      result = begin + 9 <= end && std::strncmp(begin, "undefined", 9) == 0;
+      break;
+    default:
+      result = false;
+      if (is_number_start(*begin)) {
+        type = Record::Type::NUMBER;
+        result = true;
+      }
+  }
+  return result;
+}
+
+const char *const kStoppedByHandler = "Parsing stopped by handler";
+
+/**
+ * Recursive descent lexer that reports every value to a handler instead of building Records
+ *
+ * Handler provides bool on_undefined(), on_null(), on_bool(bool), on_number(double),
+ * on_string(const char *data, std::size_t length, bool escaped), on_object_begin(), on_key(StringRef),
+ * on_object_end(), on_array_begin() and on_array_end(). Strings are given as they are in the input,
+ * escaped tells if they contain escape sequences. Any callback may return false to stop parsing.
+ *
+ * A selective reader asks handler.skip(Record::Type type) before every array or object nested
+ * in the one it parses. Those to be skipped are passed over by brackets without validation and
+ * reported with on_skipped(Record::Type type, const char *begin, const char *end) instead.
+ *
+ * Every parse function gets a pointer to the first character of the value and returns a pointer
+ * past it, or nullptr on error. Whitespace and comments are skipped inline, so the input is
+ * walked only once.
+ */
+template <class Handler, bool kSelective = false>
+class Reader {
+ public:
+  Reader(const char *end, Handler &handler) : end(end), handler(handler), error(nullptr) { }
+
+  const char *parse_value(const char *begin, Record::Type type) {
+    switch (type) {
+      case Record::UNDEFINED:
+        return parse_undefined(begin);
+      case Record::NUL:
+        return parse_null(begin);
+      case Record::BOOL:
+        return parse_bool(begin);
+      case Record::NUMBER:
+        return parse_number(begin);
+      case Record::STRING:
+        return parse_string(begin);
+      case Record::ARRAY:
+        return parse_array(begin);
+      case Record::OBJECT:
+        return parse_object(begin);
+    }
+    return fail("Invalid type");
+  }
+
+  /**
+   * Returns the message of the first error
+   */
+  const char *get_error() const { return error; }
+
+ private:
+  const char *fail(const char *message) {
+    if (!error) {
+      error = message;
+    }
+    return nullptr;
+  }
+
+  // Parses an item of an array or a value of an object
+  const char *parse_item(const char *begin, Record::Type type) {
+    return parse_item(begin, type, std::integral_constant<bool, kSelective>());
+  }
+
+  const char *parse_item(const char *begin, Record::Type type, std::false_type) {
+    return parse_value(begin, type);
+  }
+
+  const char *parse_item(const char *begin, Record::Type type, std::true_type) {
+    if ((type != Record::ARRAY && type != Record::OBJECT) || !handler.skip(type)) {
+      return parse_value(begin, type);
+    }
+    const char *item_end = skip_container(begin, end);
+    if (!item_end) {
+      return fail(type == Record::ARRAY ? "Invalid format in array: missed closing bracket"
+                                        : "Invalid format in object: missed closing brace");
+    }
+    return handler.on_skipped(type, begin, item_end) ? item_end : fail(kStoppedByHandler);
+  }
+
+  const char *parse_undefined(const char *begin) {
+    if (!handler.on_undefined()) {
+      return fail(kStoppedByHandler);
+    }
+    return (*begin == 'u') ? begin + 9 : begin;  // Holes of arrays and objects take no characters
+  }
+
+  const char *parse_null(const char *begin) {
+    return handler.on_null() ? begin + 4 : fail(kStoppedByHandler);
+  }
+
+  const char *parse_bool(const char *begin) {
+    bool value;
+    std::size_t size;
+    if (begin + 4 <= end && std::strncmp(begin, "true", 4) == 0) {
+      value = true;
+      size = 4;
+    } else if (begin + 5 <= end && std::strncmp(begin, "false", 5) == 0) {
+      value = false;
+      size = 5;
+    } else {
+      return fail("Invalid format: expected boolean");
+    }
+    return handler.on_bool(value) ? begin + size : fail(kStoppedByHandler);
+  }
+
+  const char *parse_number(const char *begin) {
+    double value;
+    std::size_t size = parse_double(begin, end, value);
+    if (!size) {
+      return fail("Invalid format of number");
+    }
+    return handler.on_number(value) ? begin + size : fail(kStoppedByHandler);
+  }
+
+  const char *parse_string(const char *begin) {
+    const char quote = *begin;
+    const char *i = find_string_stop(begin + 1, end, quote);
+    bool escaped = false;
+    while (i < end && *i == '\\') {
+      escaped = true;
+      i = skip_escape(i, end);
+      if (!i) {
+        return fail("Invalid escape sequence in string");
+      }
+      i = find_string_stop(i, end, quote);
+    }
+    if (i >= end) {
+      return fail("Error while parsing string");
+    }
+    return handler.on_string(begin + 1, i - begin - 1, escaped) ? i + 1 : fail(kStoppedByHandler);
+  }
+
+  const char *parse_object(const char *begin) {
+    Record::Type current_type;
+    if (!handler.on_object_begin()) {
+      return fail(kStoppedByHandler);
+    }
+    const char *i = skip_spaces(begin + 1, end);
+    if (i < end && *i == '}') { // In case of empty object
+      return handler.on_object_end() ? i + 1 : fail(kStoppedByHandler);
+    }
+    while (i < end) {
+      const char *key_begin = i;
+      i = skip_key_chars(i, end);
+      StringRef key(key_begin, i - key_begin);
+      i = skip_spaces(i, end);
+      if (key.empty() || i >= end || *i != ':') {
+        return fail("Invalid format in object: key is invalid");
+      }
+      i = skip_spaces(i + 1, end);
+      if (!get_type(i, end, current_type)) {
+        return fail("Invalid format in object");
+      }
+      if (!handler.on_key(key)) {
+        return fail(kStoppedByHandler);
+      }
+      i = parse_item(i, current_type);
+      if (!i) {
+        return nullptr;
+      }
+      i = skip_spaces(i, end);
+      if (i < end && *i == ',') {
+        i = skip_spaces(i + 1, end);
+        if (i < end && *i == '}') { // Trailing comma
+          return handler.on_object_end() ? i + 1 : fail(kStoppedByHandler);
+        }
+      } else if (i < end && *i == '}') {
+        return handler.on_object_end() ? i + 1 : fail(kStoppedByHandler);
+      } else {
+        return fail("Invalid format in object: missed semicolon");
+      }
+    }
+    return fail("Invalid format in object: missed closing brace");
+  }
+
+  const char *parse_array(const char *begin) {
+    Record::Type current_type;
+    if (!handler.on_array_begin()) {
+      return fail(kStoppedByHandler);
+    }
+    const char *i = skip_spaces(begin + 1, end);
+    if (i < end && *i == ']') { // In case of empty array
+      return handler.on_array_end() ? i + 1 : fail(kStoppedByHandler);
+    }
+    while (i < end) {
+      if (!get_type(i, end, current_type)) {
+        return fail("Invalid format in array");
+      }
+      i = parse_item(i, current_type);
+      if (!i) {
+        return nullptr;
+      }
+      i = skip_spaces(i, end);
+      if (i < end && *i == ',') {
+        i = skip_spaces(i + 1, end);
+      } else if (i < end && *i == ']') {
+        return handler.on_array_end() ? i + 1 : fail(kStoppedByHandler);
+      } else {
+        return fail("Invalid format in array: missed semicolon");
+      }
+    }
+    return fail("Invalid format in array: missed closing bracket");
+  }
+
+  const char *const end;
+  Handler &handler;
+  const char *error;
+};
+
+/**
+ * Handler of Reader that assembles Records
+ *
+ * Values of containers that are not finished yet are kept on one stack, so every container
+ * is built at once with the exact size when its end is reached.
+ */
+class RecordBuilder {
+ public:
+  RecordBuilder(MemoryResource *memory, KeyPool *pool, bool borrow) : memory(memory), pool(pool), borrow(borrow) { }
+
+  // Builder for a selective Reader, every nested container is skipped and becomes a lazy record over source
+  explicit RecordBuilder(std::shared_ptr<const std::string> source)
+      : memory(nullptr), pool(nullptr), borrow(false), source(std::move(source)) { }
+
+  bool on_undefined() {
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::UNDEFINED]);
+    values.emplace_back();
+    return true;
+  }
+
+  bool on_null() {
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::NUL]);
+    values.emplace_back(nullptr);
+    return true;
+  }
+
+  bool on_bool(bool value) {
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::BOOL]);
+    values.emplace_back(value);
+    return true;
+  }
+
+  bool on_number(double value) {
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::NUMBER]);
+    values.emplace_back(value);
+    return true;
+  }
+
+  bool on_string(const char *data, std::size_t length, bool escaped) {
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::STRING]);
+    values.push_back(Record::from_source(data, length, escaped, memory, borrow));
+    return true;
+  }
+
+  bool on_object_begin() {
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::OBJECT]);
+    starts.push_back(values.size());
+    JSTP_CPP_COUNT(count_depth(starts.size()));
+    return true;
+  }
+
+  bool on_key(StringRef key) {
+    keys.push_back(pool ? pool->intern(key) : borrow ? Key::borrow(key) : Key(key));
+    return true;
+  }
+
+  bool on_object_end() {
+    const std::size_t first = starts.back();
+    const std::size_t count = values.size() - first;
+    const std::size_t first_key = keys.size() - count;
+    starts.pop_back();
+    const Allocator<Record::object::value_type> allocator(memory);
+    Record::object object(allocator);
+    object.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      object[std::move(keys[first_key + i])] = std::move(values[first + i]); // Later duplicates win, as in JS
+    }
+    keys.resize(first_key);
+    values.resize(first);
+    values.push_back(Record(std::move(object)));
+    return true;
+  }
+
+  bool on_array_begin() {
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::ARRAY]);
+    starts.push_back(values.size());
+    JSTP_CPP_COUNT(count_depth(starts.size()));
+    return true;
+  }
+
+  bool on_array_end() {
+    const std::size_t first = starts.back();
+    starts.pop_back();
+    Record::array array(std::make_move_iterator(values.begin() + first), std::make_move_iterator(values.end()),
+                        Allocator<Record>(memory));
+    values.resize(first);
+    values.push_back(Record(std::move(array)));
+    return true;
+  }
+
+  bool skip(Record::Type type) { return true; }
+
+  bool on_skipped(Record::Type type, const char *begin, const char *end) {
+    JSTP_CPP_COUNT(++pending_stats().nodes[type]);
+    values.push_back(Record::lazy(type, source, begin, end));
+    return true;
+  }
+
+  Record result() { return std::move(values.back()); }
+
+  // Drops the values of a failed parse, so the builder may be reused
+  void clear() {
+    values.clear();
+    keys.clear();
+    starts.clear();
+  }
+
+ private:
+  MemoryResource *const memory;
+  // Keys of objects are interned if it is given
+  KeyPool *const pool;
+  // Strings and keys refer to the input instead of copying it
+  const bool borrow;
+  std::vector<Record> values;
+  std::vector<Key> keys;
+  // Positions in values where unfinished containers start
+  std::vector<std::size_t> starts;
+  const std::shared_ptr<const std::string> source;
+};
+
+/**
+ * Parses a Record that spans the whole input, returns nullptr on success or an error message
+ */
+template <class Handler, bool kSelective = false>
+const char *read_record(const char *begin, const char *end, Handler &handler) {
+  JSTP_CPP_TIME(parse_ns);
+  JSTP_CPP_COUNT(pending_stats().bytes_parsed += end - begin);
+  begin = skip_spaces(begin, end);
+  Record::Type type;
+  if (!get_type(begin, end, type)) {
+    return "Invalid type";
+  }
+  Reader<Handler, kSelective> reader(end, handler);
+  const char *i = reader.parse_value(begin, type);
+  if (!i) {
+    return reader.get_error();
+  }
+  if (skip_spaces(i, end) != end) {
+    return "Invalid format";
+  }
+  return nullptr;
+}
+
+}
+
+#endif //JSTP_CPP_JSRS_READER_H
@@ -0,0 +1,320 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+// Character classes and bulk scanning shared by the parsers, not a part of the public interface
+
+#ifndef JSTP_CPP_JSRS_SCAN_H
+#define JSTP_CPP_JSRS_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSTP_CPP_SCAN_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace jstp {
+
+inline bool is_space(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+inline bool is_key_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+inline bool is_number_char(char c) {
+  return (c >= '0' && c <= '9') || c == '.' || c == '+' || c == '-' || c == 'e' || c == 'E';
+}
+
+/**
+ * Returns true if a number may start with c
+ */
+inline bool is_number_start(char c) {
+  return (c >= '0' && c <= '9') || c == '.' || c == '+' || c == '-';
+}
+
+// Bulk scanning
+//
+// Input is classified by blocks of kScanBlockSize bytes, every class is a bit mask
+// with the lowest bit standing for the first byte of a block. Scanning functions go
+// block by block while a whole block fits into the input and finish byte by byte,
+// so they never read past the end.
+
+#if defined(__AVX2__)
+const std::ptrdiff_t kScanBlockSize = 32;
+const std::uint32_t kScanBlockMask = 0xFFFFFFFFu;
+#else
+const std::ptrdiff_t kScanBlockSize = 16;
+const std::uint32_t kScanBlockMask = 0xFFFFu;
+#endif
+
+struct BlockClasses {
+  std::uint32_t double_quote;
+  std::uint32_t single_quote;
+  std::uint32_t backslash;
+  std::uint32_t structural;     // {}[],:
+  std::uint32_t whitespace;
+  std::uint32_t comment_start;  // /
+  std::uint32_t key;            // [A-Za-z0-9_]
+};
+
+inline unsigned count_trailing_zeros(std::uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+#if defined(__AVX2__)
+
+inline void classify(const char *block, BlockClasses &classes) {
+  const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+  const __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+  const __m256i structural =
+      _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('{')),
+                                                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('}'))),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('[')),
+                                                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8(']')))),
+                      _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(',')),
+                                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8(':'))));
+  const __m256i whitespace =
+      _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')),
+                      _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('\t' - 1)),
+                                       _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), c)));
+  const __m256i key =
+      _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                                       _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c)),
+                                      _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                                       _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower))),
+                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+  classes.double_quote = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\"'))));
+  classes.single_quote = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\''))));
+  classes.backslash = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\'))));
+  classes.structural = static_cast<std::uint32_t>(_mm256_movemask_epi8(structural));
+  classes.whitespace = static_cast<std::uint32_t>(_mm256_movemask_epi8(whitespace));
+  classes.comment_start = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('/'))));
+  classes.key = static_cast<std::uint32_t>(_mm256_movemask_epi8(key));
+}
+
+#elif defined(JSTP_CPP_SCAN_SSE2)
+
+inline void classify(const char *block, BlockClasses &classes) {
+  const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+  const __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  const __m128i structural =
+      _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('{')),
+                                             _mm_cmpeq_epi8(c, _mm_set1_epi8('}'))),
+                                _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('[')),
+                                             _mm_cmpeq_epi8(c, _mm_set1_epi8(']')))),
+                   _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(',')),
+                                _mm_cmpeq_epi8(c, _mm_set1_epi8(':'))));
+  const __m128i whitespace =
+      _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                   _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)),
+                                 _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1))));
+  const __m128i key =
+      _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                              _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1))),
+                                _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                              _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)))),
+                   _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+  classes.double_quote = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('\"'))));
+  classes.single_quote = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('\''))));
+  classes.backslash = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('\\'))));
+  classes.structural = static_cast<std::uint32_t>(_mm_movemask_epi8(structural));
+  classes.whitespace = static_cast<std::uint32_t>(_mm_movemask_epi8(whitespace));
+  classes.comment_start = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('/'))));
+  classes.key = static_cast<std::uint32_t>(_mm_movemask_epi8(key));
+}
+
+#else
+
+inline void classify(const char *block, BlockClasses &classes) {
+  classes = BlockClasses();
+  for (std::ptrdiff_t i = 0; i < kScanBlockSize; ++i) {
+    const char c = block[i];
+    const std::uint32_t bit = std::uint32_t(1) << i;
+    if (c == '\"') classes.double_quote |= bit;
+    if (c == '\'') classes.single_quote |= bit;
+    if (c == '\\') classes.backslash |= bit;
+    if (c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':') classes.structural |= bit;
+    if (is_space(c)) classes.whitespace |= bit;
+    if (c == '/') classes.comment_start |= bit;
+    if (is_key_char(c)) classes.key |= bit;
+  }
+}
+
+#endif
+
+/**
+ * Returns a pointer to the first character that is not a whitespace, or end
+ */
+inline const char *skip_whitespace(const char *begin, const char *end) {
+  while (end - begin >= kScanBlockSize) {
+    BlockClasses classes;
+    classify(begin, classes);
+    const std::uint32_t significant = ~classes.whitespace & kScanBlockMask;
+    if (significant) {
+      return begin + count_trailing_zeros(significant);
+    }
+    begin += kScanBlockSize;
+  }
+  while (begin < end && is_space(*begin)) ++begin;
+  return begin;
+}
+
+/**
+ * Returns a pointer to the first character that is not allowed in keys, or end
+ */
+inline const char *skip_key_chars(const char *begin, const char *end) {
+  while (end - begin >= kScanBlockSize) {
+    BlockClasses classes;
+    classify(begin, classes);
+    const std::uint32_t other = ~classes.key & kScanBlockMask;
+    if (other) {
+      return begin + count_trailing_zeros(other);
+    }
+    begin += kScanBlockSize;
+  }
+  while (begin < end && is_key_char(*begin)) ++begin;
+  return begin;
+}
+
+/**
+ * Returns a pointer to the first quote character or backslash inside of a string body,
+ * or end if there is none
+ */
+inline const char *find_string_stop(const char *begin, const char *end, char quote) {
+  while (end - begin >= kScanBlockSize) {
+    BlockClasses classes;
+    classify(begin, classes);
+    const std::uint32_t stops = (quote == '\'' ? classes.single_quote : classes.double_quote) | classes.backslash;
+    if (stops) {
+      return begin + count_trailing_zeros(stops);
+    }
+    begin += kScanBlockSize;
+  }
+  while (begin < end && *begin != quote && *begin != '\\') ++begin;
+  return begin;
+}
+
+/**
+ * Returns a pointer to the first structural character, quote or slash, or end if there is none
+ */
+inline const char *find_token_stop(const char *begin, const char *end) {
+  while (end - begin >= kScanBlockSize) {
+    BlockClasses classes;
+    classify(begin, classes);
+    const std::uint32_t stops =
+        classes.structural | classes.double_quote | classes.single_quote | classes.comment_start;
+    if (stops) {
+      return begin + count_trailing_zeros(stops);
+    }
+    begin += kScanBlockSize;
+  }
+  while (begin < end && *begin != '{' && *begin != '}' && *begin != '[' && *begin != ']' && *begin != ','
+      && *begin != ':' && *begin != '\"' && *begin != '\'' && *begin != '/') {
+    ++begin;
+  }
+  return begin;
+}
+
+/**
+ * Skips a string, a comment or a slash that starts at begin. Returns a pointer past it,
+ * or nullptr if a string or a multiline comment is not terminated.
+ */
+inline const char *skip_quoted(const char *begin, const char *end) {
+  if (*begin == '/') {
+    const char *i = begin + 1;
+    if (i < end && *i == '/') {
+      while (i < end && *i != '\n' && *i != '\r') ++i;
+      return i;
+    }
+    if (i < end && *i == '*') {
+      for (i += 1; i + 1 < end; ++i) {
+        if (*i == '*' && i[1] == '/') {
+          return i + 2;
+        }
+      }
+      return nullptr;
+    }
+    return i;
+  }
+  const char *i = find_string_stop(begin + 1, end, *begin);
+  while (i < end && *i == '\\') {
+    i = (i + 2 < end) ? find_string_stop(i + 2, end, *begin) : end;
+  }
+  return i < end ? i + 1 : nullptr;
+}
+
+/**
+ * Skips an array or an object that starts with the bracket at begin, minding strings and comments but not validating
+ * anything else. Returns a pointer past its closing bracket, or nullptr if brackets are not balanced.
+ */
+inline const char *skip_container(const char *begin, const char *end) {
+  std::size_t depth = 0;
+  const char *i = begin;
+  while ((i = find_token_stop(i, end)) < end) {
+    switch (*i) {
+      case '{':
+      case '[':
+        ++depth;
+        ++i;
+        break;
+      case '}':
+      case ']':
+        ++i;
+        if (--depth == 0) {
+          return i;
+        }
+        break;
+      case '\"':
+      case '\'':
+      case '/':
+        i = skip_quoted(i, end);
+        if (!i) {
+          return nullptr;
+        }
+        break;
+      default:
+        ++i;
+    }
+  }
+  return nullptr;
+}
+
+}
+
+#endif //JSTP_CPP_JSRS_SCAN_H
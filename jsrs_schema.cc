@@ -0,0 +1,473 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_schema.h"
+#include "jsrs_number.h"
+#include "jsrs_reader.h"
+#include "jsrs_string.h"
+
+#include <cstring>
+#include <memory>
+
+namespace jstp {
+
+static const char *type_name(Record::Type type) {
+  switch (type) {
+    case Record::UNDEFINED:
+      return "undefined";
+    case Record::NUL:
+      return "null";
+    case Record::BOOL:
+      return "boolean";
+    case Record::NUMBER:
+      return "number";
+    case Record::STRING:
+      return "string";
+    case Record::ARRAY:
+      return "array";
+    case Record::OBJECT:
+      return "object";
+  }
+  return "";
+}
+
+// Adds a key or an index of an array to the front of a path, as the error goes up from the value
+static void prepend_key(StringRef key, std::string &path) {
+  path.insert(0, path.empty() || path[0] == '[' ? key.str() : key.str() + '.');
+}
+
+static void prepend_index(std::size_t index, std::string &path) {
+  path.insert(0, '[' + std::to_string(index) + ']' + (path.empty() || path[0] == '[' ? "" : "."));
+}
+
+static std::string mismatch_message(const std::string &path, const std::string &what) {
+  return "Schema mismatch" + (path.empty() ? std::string() : " at " + path) + ": " + what;
+}
+
+/**
+ * Parser of the records of a Schema, builds Records directly without a handler
+ */
+class SchemaParser {
+ public:
+  SchemaParser(const std::vector<Schema::Node> &nodes, const char *end)
+      : nodes(nodes), end(end), mismatch(false), depth(0), builder(nullptr, nullptr, false) { }
+
+  // Parses the value at begin, returns a pointer past it or nullptr on an error
+  const char *parse(const char *begin, std::size_t node, Record &out) {
+    const Schema::Node &schema = nodes[node];
+    if (schema.any) {
+      return parse_any(begin, out);
+    }
+    if (begin >= end) {
+      return fail("Invalid format");
+    }
+    if (schema.optional || schema.type == Record::UNDEFINED) {
+      if (*begin == ',' || *begin == ']') {  // Holes of arrays and objects take no characters
+        JSTP_CPP_COUNT(++pending_stats().nodes[Record::UNDEFINED]);
+        out = Record();
+        return begin;
+      }
+      if (begin + 9 <= end && std::strncmp(begin, "undefined", 9) == 0) {
+        JSTP_CPP_COUNT(++pending_stats().nodes[Record::UNDEFINED]);
+        out = Record();
+        return begin + 9;
+      }
+    }
+    switch (schema.type) {
+      case Record::UNDEFINED:
+        break;
+      case Record::NUL:
+        if (begin + 4 <= end && std::strncmp(begin, "null", 4) == 0) {
+          JSTP_CPP_COUNT(++pending_stats().nodes[Record::NUL]);
+          out = Record(nullptr);
+          return begin + 4;
+        }
+        break;
+      case Record::BOOL:
+        if (begin + 4 <= end && std::strncmp(begin, "true", 4) == 0) {
+          JSTP_CPP_COUNT(++pending_stats().nodes[Record::BOOL]);
+          out = Record(true);
+          return begin + 4;
+        }
+        if (begin + 5 <= end && std::strncmp(begin, "false", 5) == 0) {
+          JSTP_CPP_COUNT(++pending_stats().nodes[Record::BOOL]);
+          out = Record(false);
+          return begin + 5;
+        }
+        break;
+      case Record::NUMBER: {
+        double value;
+        const std::size_t size = parse_double(begin, end, value);
+        if (size) {
+          JSTP_CPP_COUNT(++pending_stats().nodes[Record::NUMBER]);
+          out = Record(value);
+          return begin + size;
+        }
+        break;
+      }
+      case Record::STRING:
+        if (*begin == '\'' || *begin == '\"') {
+          return parse_string(begin, out);
+        }
+        break;
+      case Record::ARRAY:
+        if (*begin == '[') {
+          JSTP_CPP_COUNT(++pending_stats().nodes[Record::ARRAY]);
+          ++depth;
+          JSTP_CPP_COUNT(count_depth(depth));
+          const char *i = parse_array(begin, schema, out);
+          --depth;
+          return i;
+        }
+        break;
+      case Record::OBJECT:
+        if (*begin == '{') {
+          if (schema.open) {
+            return parse_any(begin, out);
+          }
+          JSTP_CPP_COUNT(++pending_stats().nodes[Record::OBJECT]);
+          ++depth;
+          JSTP_CPP_COUNT(count_depth(depth));
+          const char *i = parse_object(begin, schema, out);
+          --depth;
+          return i;
+        }
+        break;
+    }
+    mismatch = true;
+    what = std::string("expected ") + type_name(schema.type) + (schema.optional ? " or undefined" : "");
+    return nullptr;
+  }
+
+  std::string error() const { return mismatch ? mismatch_message(path, what) : what; }
+
+ private:
+  const char *fail(const char *message) {
+    what = message;
+    return nullptr;
+  }
+
+  const char *parse_any(const char *begin, Record &out) {
+    Record::Type type;
+    if (!get_type(begin, end, type)) {
+      return fail("Invalid type");
+    }
+    Reader<RecordBuilder> reader(end, builder);
+    const char *i = reader.parse_value(begin, type);
+    if (i) {
+      out = builder.result();
+    } else {
+      fail(reader.get_error());
+    }
+    builder.clear();
+    return i;
+  }
+
+  const char *parse_string(const char *begin, Record &out) {
+    const char quote = *begin;
+    const char *i = find_string_stop(begin + 1, end, quote);
+    bool escaped = false;
+    while (i < end && *i == '\\') {
+      escaped = true;
+      i = skip_escape(i, end);
+      if (!i) {
+        return fail("Invalid escape sequence in string");
+      }
+      i = find_string_stop(i, end, quote);
+    }
+    if (i >= end) {
+      return fail("Error while parsing string");
+    }
+    JSTP_CPP_COUNT(++pending_stats().nodes[Record::STRING]);
+    out = Record::from_source(begin + 1, i - begin - 1, escaped, nullptr, false);
+    return i + 1;
+  }
+
+  const char *parse_array(const char *begin, const Schema::Node &schema, Record &out) {
+    Record::array items;
+    const char *i = skip_spaces(begin + 1, end);
+    if (i < end && *i == ']') {  // In case of empty array
+      out = Record(std::move(items));
+      return i + 1;
+    }
+    while (i < end) {
+      items.emplace_back();
+      const char *item_end = schema.items == Schema::kNoNode ? parse_any(i, items.back())
+                                                             : parse(i, schema.items, items.back());
+      if (!item_end) {
+        prepend_index(items.size() - 1, path);
+        return nullptr;
+      }
+      i = skip_spaces(item_end, end);
+      if (i < end && *i == ',') {
+        i = skip_spaces(i + 1, end);
+      } else if (i < end && *i == ']') {
+        out = Record(std::move(items));
+        return i + 1;
+      } else {
+        return fail("Invalid format in array: missed semicolon");
+      }
+    }
+    return fail("Invalid format in array: missed closing bracket");
+  }
+
+  const char *parse_object(const char *begin, const Schema::Node &schema, Record &out) {
+    const std::vector<Schema::Field> &fields = schema.fields;
+    Record::object object;
+    object.reserve(fields.size());
+    // Flags of the fields that are present
+    const std::size_t flags = seen.size();
+    seen.resize(flags + fields.size(), false);
+    std::size_t next_field = 0;
+    const char *i = skip_spaces(begin + 1, end);
+    while (i < end && *i != '}') {
+      const char *key_begin = i;
+      i = skip_key_chars(i, end);
+      StringRef key(key_begin, i - key_begin);
+      i = skip_spaces(i, end);
+      if (key.empty() || i >= end || *i != ':') {
+        return fail("Invalid format in object: key is invalid");
+      }
+      i = skip_spaces(i + 1, end);
+      std::size_t field = next_field;
+      if (field >= fields.size() || fields[field].key.ref() != key) {  // Keys out of the order are searched
+        for (field = 0; field < fields.size() && fields[field].key.ref() != key; ++field) { }
+        if (field == fields.size()) {
+          mismatch = true;
+          what = "unexpected key " + key.str();
+          return nullptr;
+        }
+      }
+      next_field = field + 1;
+      Record value;
+      i = parse(i, fields[field].node, value);
+      if (!i) {
+        prepend_key(key, path);
+        return nullptr;
+      }
+      if (seen[flags + field]) {  // Later duplicates win, as in JS
+        object[fields[field].key] = std::move(value);
+      } else {
+        seen[flags + field] = true;
+        object.emplace(fields[field].key, std::move(value));
+      }
+      i = skip_spaces(i, end);
+      if (i < end && *i == ',') {
+        i = skip_spaces(i + 1, end);
+      } else if (i >= end || *i != '}') {
+        return i < end ? fail("Invalid format in object: missed semicolon")
+                       : fail("Invalid format in object: missed closing brace");
+      }
+    }
+    if (i >= end) {
+      return fail("Invalid format in object: missed closing brace");
+    }
+    for (std::size_t field = 0; field < fields.size(); ++field) {
+      if (!seen[flags + field] && !nodes[fields[field].node].optional && !nodes[fields[field].node].any) {
+        mismatch = true;
+        what = "missing key " + fields[field].key.str();
+        return nullptr;
+      }
+    }
+    seen.resize(flags);
+    out = Record(std::move(object));
+    return i + 1;
+  }
+
+  const std::vector<Schema::Node> &nodes;
+  const char *const end;
+  // Message of the error, and the path of the value for a mismatch
+  std::string what;
+  std::string path;
+  bool mismatch;
+  std::vector<bool> seen;
+  // Nesting of the arrays and objects being parsed, for the statistics
+  std::size_t depth;
+  // For the values that are not checked
+  RecordBuilder builder;
+};
+
+// Schema implementation
+
+const std::size_t Schema::kNoNode;
+
+Schema::Schema() {
+  std::string err;
+  compile(Record("any"), err);
+}
+
+bool Schema::compile(const std::string &metadata, std::string &err) {
+  std::string error;
+  Record record = Record::parse(metadata, error);
+  if (!error.empty()) {
+    err = error;
+    return false;
+  }
+  return compile(record, err);
+}
+
+bool Schema::compile(const Record &metadata, std::string &err) {
+  std::vector<Node> previous;
+  previous.swap(nodes);
+  if (compile_node(metadata, err) == kNoNode) {
+    nodes.swap(previous);
+    return false;
+  }
+  return true;
+}
+
+// Appends the nodes of metadata, returns the index of its node or kNoNode if it is malformed
+std::size_t Schema::compile_node(const Record &metadata, std::string &err) {
+  const std::size_t index = nodes.size();
+  nodes.push_back(Node{Record::UNDEFINED, false, false, kNoNode, std::vector<Field>(), false});
+  switch (metadata.type()) {
+    case Record::STRING: {
+      std::string name = metadata.string_value();
+      if (!name.empty() && name.back() == '?') {
+        nodes[index].optional = true;
+        name.pop_back();
+      }
+      if (name == "any") {
+        nodes[index].any = true;
+        return index;
+      }
+      for (int type = Record::UNDEFINED; type <= Record::OBJECT; ++type) {
+        if (name == type_name(static_cast<Record::Type>(type))) {
+          nodes[index].type = static_cast<Record::Type>(type);
+          nodes[index].open = type == Record::OBJECT;
+          return index;
+        }
+      }
+      err = "Invalid metadata: unknown type " + metadata.string_value();
+      return kNoNode;
+    }
+    case Record::ARRAY: {
+      nodes[index].type = Record::ARRAY;
+      const Record::array &items = metadata.array_items();
+      if (items.size() > 1) {
+        err = "Invalid metadata: an array must have one item";
+        return kNoNode;
+      }
+      if (!items.empty()) {
+        const std::size_t item = compile_node(items[0], err);
+        if (item == kNoNode) {
+          return kNoNode;
+        }
+        nodes[index].items = item;
+      }
+      return index;
+    }
+    case Record::OBJECT: {
+      nodes[index].type = Record::OBJECT;
+      for (auto &entry : metadata.object_items()) {
+        const std::size_t field = compile_node(entry.second, err);
+        if (field == kNoNode) {
+          return kNoNode;
+        }
+        // Keys are shared with the records, so they are not allocated by every parse
+        nodes[index].fields.push_back(Field{Key(std::make_shared<const std::string>(entry.first.str())), field});
+      }
+      return index;
+    }
+    default:
+      err = "Invalid metadata";
+      return kNoNode;
+  }
+}
+
+Record Schema::parse(const std::string &in, std::string &err) const {
+  JSTP_CPP_TIME(parse_ns);
+  JSTP_CPP_COUNT(pending_stats().bytes_parsed += in.size());
+  const char *end = in.data() + in.size();
+  SchemaParser parser(nodes, end);
+  Record result;
+  const char *i = parser.parse(skip_spaces(in.data(), end), 0, result);
+  if (!i) {
+    err = parser.error();
+    return Record();
+  }
+  if (skip_spaces(i, end) != end) {
+    err = "Invalid format";
+    return Record();
+  }
+  return result;
+}
+
+bool Schema::validate(const Record &record, std::string &err) const {
+  std::string path;
+  std::string what;
+  if (!validate_node(record, 0, path, what)) {
+    err = mismatch_message(path, what);
+    return false;
+  }
+  return true;
+}
+
+bool Schema::validate_node(const Record &record, std::size_t node, std::string &path, std::string &what) const {
+  const Node &schema = nodes[node];
+  if (schema.any || (schema.optional && record.is_undefined())) {
+    return true;
+  }
+  if (record.type() != schema.type) {
+    what = std::string("expected ") + type_name(schema.type) + (schema.optional ? " or undefined" : "");
+    return false;
+  }
+  if (schema.type == Record::ARRAY && schema.items != kNoNode) {
+    const Record::array &items = record.array_items();
+    for (std::size_t i = 0; i < items.size(); ++i) {
+      if (!validate_node(items[i], schema.items, path, what)) {
+        prepend_index(i, path);
+        return false;
+      }
+    }
+  } else if (schema.type == Record::OBJECT && !schema.open) {
+    const Record::object &entries = record.object_items();
+    for (auto &entry : entries) {
+      std::size_t field = 0;
+      while (field < schema.fields.size() && schema.fields[field].key.ref() != entry.first.ref()) {
+        ++field;
+      }
+      if (field == schema.fields.size()) {
+        what = "unexpected key " + entry.first.str();
+        return false;
+      }
+      if (!validate_node(entry.second, schema.fields[field].node, path, what)) {
+        prepend_key(entry.first.ref(), path);
+        return false;
+      }
+    }
+    for (auto &field : schema.fields) {
+      const Node &value = nodes[field.node];
+      if (!value.optional && !value.any && entries.find(field.key.ref()) == entries.end()) {
+        what = "missing key " + field.key.str();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// end of Schema implementation
+
+}
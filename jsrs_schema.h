@@ -0,0 +1,102 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JSTP_CPP_JSRS_SCHEMA_H
+#define JSTP_CPP_JSRS_SCHEMA_H
+
+#include "jsrs.h"
+
+#include <string>
+#include <vector>
+
+namespace jstp {
+
+/**
+ * JSTP Metadata compiled into a parser and a validator of the records it describes
+ *
+ * Metadata is itself a record:
+ *   'undefined', 'null', 'boolean', 'number', 'string', 'array', 'object' or 'any' stand for a value
+ *   of that type, a '?' suffix such as 'string?' lets the value be undefined or a key be missing;
+ *   {key: metadata, ...} stands for an object with these keys and no others;
+ *   [metadata] stands for an array of items that conform to metadata, [] for an array of any items.
+ * For example {name: 'string', age: 'number?', tags: ['string'], address: {city: 'string'}}.
+ *
+ * The parser expects the type of every value from the metadata, so it reads it without looking
+ * the type up first, and fails at the first value that does not conform. Keys that come in the order
+ * of the metadata are matched at once. Keys of the results are shared with the schema.
+ */
+class Schema {
+ public:
+  Schema();
+
+  /**
+   * Compiles metadata replacing the previous one, returns false and sets err if it is malformed
+   */
+  bool compile(const std::string &metadata, std::string &err);
+  bool compile(const char *metadata, std::string &err) { return compile(std::string(metadata), err); }
+  bool compile(const Record &metadata, std::string &err);
+
+  /**
+   * Parses in, returns UNDEFINED and sets err if it is malformed or does not conform to the metadata.
+   * The error tells the path of the value, e.g. "Schema mismatch at tags[1]: expected string".
+   */
+  Record parse(const std::string &in, std::string &err) const;
+
+  /**
+   * Checks that record conforms to the metadata, returns false and sets err otherwise
+   */
+  bool validate(const Record &record, std::string &err) const;
+
+ private:
+  friend class SchemaParser;
+
+  static const std::size_t kNoNode = static_cast<std::size_t>(-1);
+
+  struct Field {
+    Key key;
+    std::size_t node;
+  };
+
+  /**
+   * Metadata of a value, the items of an array and the fields of an object have nodes of their own
+   */
+  struct Node {
+    Record::Type type;
+    bool any;                   // Any value conforms, type is not checked
+    bool optional;              // Undefined conforms too
+    std::size_t items;          // Node of the items of an array, kNoNode if they are not checked
+    std::vector<Field> fields;  // Keys of an object in the order of the metadata
+    bool open;                  // Any keys and values are allowed, for 'object'
+  };
+
+  std::size_t compile_node(const Record &metadata, std::string &err);
+  bool validate_node(const Record &record, std::size_t node, std::string &path, std::string &err) const;
+
+  // The first one is the root
+  std::vector<Node> nodes;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_SCHEMA_H
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_schema.h"
+
+static const char kPerson[] = "{name:'string',age:'number?',alive:'boolean',tags:['string'],"
+                              "address:{city:'string',zip:'any'},extra:'object',spouse:'null?',list:[]}";
+
+TEST(jsrs_schema_test, jsrs_schema_test_Parse) {
+  jstp::Schema schema;
+  std::string err = "";
+  ASSERT_TRUE(schema.compile(kPerson, err));
+  EXPECT_EQ("", err);
+
+  const std::vector<std::string> inputs = {
+      "{name:'Marcus',age:58,alive:false,tags:['emperor','philosopher'],address:{city:'Rome',zip:[1,{a:2}]},"
+          "extra:{x:[1]},spouse:null,list:[1,'two',{}]}",
+      " { list:[], extra:{}, address:{zip:undefined,city:\"Rome\\n\"}, tags:[], alive:true, name:'' } ",
+      "{name:'a',age:undefined,alive:true,tags:['x'],address:{city:'b',},extra:{},list:[,],name:'b',}",
+  };
+  for (auto &in : inputs) {
+    jstp::Record expected = jstp::Record::parse(in, err);
+    ASSERT_EQ("", err);
+    jstp::Record record = schema.parse(in, err);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(expected, record);
+    EXPECT_EQ(expected.stringify(), record.stringify());
+    EXPECT_TRUE(schema.validate(record, err));
+  }
+
+  jstp::Record record = schema.parse(inputs[0], err);
+  EXPECT_EQ("Marcus", record["name"].string_value());
+  EXPECT_EQ("philosopher", record["tags"][1].string_value());
+  EXPECT_EQ(2, record["address"]["zip"][1]["a"].number_value());
+
+  jstp::Schema any;
+  EXPECT_EQ(jstp::Record::parse(inputs[0], err), any.parse(inputs[0], err));
+}
+
+TEST(jsrs_schema_test, jsrs_schema_test_Mismatch) {
+  jstp::Schema schema;
+  std::string err = "";
+  ASSERT_TRUE(schema.compile(kPerson, err));
+  const std::string valid = "{name:'Marcus',alive:true,tags:['a','b'],address:{city:'Rome',zip:1},extra:{},list:[]}";
+  const std::vector<std::pair<std::string, std::string>> cases = {
+      {"[]", "Schema mismatch: expected object"},
+      {"{name:1}", "Schema mismatch at name: expected string"},
+      {"{name:'a',age:'58'}", "Schema mismatch at age: expected number or undefined"},
+      {"{name:'a',tags:['a',2]}", "Schema mismatch at tags[1]: expected string"},
+      {"{name:'a',address:{city:null}}", "Schema mismatch at address.city: expected string"},
+      {"{name:'a',address:{town:'Rome'}}", "Schema mismatch at address: unexpected key town"},
+      {"{name:'a',alive:true,tags:[],extra:{},list:[]}", "Schema mismatch: missing key address"},
+      {"{name:'a',alive:true,tags:[],address:{zip:1},extra:{},list:[]}", "Schema mismatch at address: missing key city"},
+      {"{name:'a',extra:[]}", "Schema mismatch at extra: expected object"},
+      {"{name:'a',tags:[,]}", "Schema mismatch at tags[0]: expected string"},
+      {"{name:'a' alive:true}", "Invalid format in object: missed semicolon"},
+      {"{name:'a',tags:['a',", "Invalid format in array: missed closing bracket"},
+      {valid + " 1", "Invalid format"},
+  };
+  for (auto &test : cases) {
+    err = "";
+    EXPECT_EQ(jstp::Record(), schema.parse(test.first, err));
+    EXPECT_EQ(test.second, err) << test.first;
+    jstp::Record record = jstp::Record::parse(test.first, err);
+    if (err.empty() && test.second.find("Schema mismatch") == 0) {
+      EXPECT_FALSE(schema.validate(record, err));
+      EXPECT_EQ(test.second, err) << test.first;
+    }
+  }
+  err = "";
+  EXPECT_NE(jstp::Record(), schema.parse(valid, err));
+  EXPECT_EQ("", err);
+
+  ASSERT_TRUE(schema.compile("[{id:'number'}]", err));
+  EXPECT_EQ("Schema mismatch at [1].id: expected number", (schema.parse("[{id:1},{id:'2'}]", err), err));
+}
+
+TEST(jsrs_schema_test, jsrs_schema_test_Compile) {
+  jstp::Schema schema;
+  std::string err = "";
+  EXPECT_FALSE(schema.compile("{a:'integer'}", err));
+  EXPECT_EQ("Invalid metadata: unknown type integer", err);
+  EXPECT_FALSE(schema.compile("['number','string']", err));
+  EXPECT_EQ("Invalid metadata: an array must have one item", err);
+  EXPECT_FALSE(schema.compile("{a:1}", err));
+  EXPECT_EQ("Invalid metadata", err);
+  err = "";
+  EXPECT_EQ(jstp::Record(1.0), schema.parse("1", err));  // The previous schema is kept
+  ASSERT_TRUE(schema.compile("'number'", err));
+  EXPECT_EQ(jstp::Record(), schema.parse("'1'", err));
+  EXPECT_EQ("Schema mismatch: expected number", err);
+}
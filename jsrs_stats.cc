@@ -0,0 +1,168 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_stats.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace jstp {
+
+const int Stats::kTypes;
+
+void Stats::clear() {
+  bytes_parsed = 0;
+  bytes_serialized = 0;
+  for (int i = 0; i < kTypes; ++i) {
+    nodes[i] = 0;
+  }
+  allocations = 0;
+  bytes_allocated = 0;
+  max_depth = 0;
+  prepass_ns = 0;
+  parse_ns = 0;
+  serialize_ns = 0;
+}
+
+Stats &Stats::operator+=(const Stats &other) {
+  bytes_parsed += other.bytes_parsed;
+  bytes_serialized += other.bytes_serialized;
+  for (int i = 0; i < kTypes; ++i) {
+    nodes[i] += other.nodes[i];
+  }
+  allocations += other.allocations;
+  bytes_allocated += other.bytes_allocated;
+  if (other.max_depth > max_depth) {
+    max_depth = other.max_depth;
+  }
+  prepass_ns += other.prepass_ns;
+  parse_ns += other.parse_ns;
+  serialize_ns += other.serialize_ns;
+  return *this;
+}
+
+namespace {
+
+// Process-wide totals, every field of Stats in the order of declaration
+struct GlobalStats {
+  std::atomic<std::uint64_t> bytes_parsed;
+  std::atomic<std::uint64_t> bytes_serialized;
+  std::atomic<std::uint64_t> nodes[Stats::kTypes];
+  std::atomic<std::uint64_t> allocations;
+  std::atomic<std::uint64_t> bytes_allocated;
+  std::atomic<std::uint64_t> max_depth;
+  std::atomic<std::uint64_t> prepass_ns;
+  std::atomic<std::uint64_t> parse_ns;
+  std::atomic<std::uint64_t> serialize_ns;
+};
+
+GlobalStats global;
+
+thread_local StatsScope *current_scope = nullptr;
+thread_local std::size_t timer_depth = 0;
+
+std::uint64_t now_ns() {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+void add(std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+  if (value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+}
+
+}
+
+void publish_stats(const Stats &stats) {
+  for (StatsScope *scope = current_scope; scope; scope = scope->outer) {
+    scope->stats += stats;
+  }
+  add(global.bytes_parsed, stats.bytes_parsed);
+  add(global.bytes_serialized, stats.bytes_serialized);
+  for (int i = 0; i < Stats::kTypes; ++i) {
+    add(global.nodes[i], stats.nodes[i]);
+  }
+  add(global.allocations, stats.allocations);
+  add(global.bytes_allocated, stats.bytes_allocated);
+  std::uint64_t depth = global.max_depth.load(std::memory_order_relaxed);
+  while (stats.max_depth > depth && !global.max_depth.compare_exchange_weak(depth, stats.max_depth)) { }
+  add(global.prepass_ns, stats.prepass_ns);
+  add(global.parse_ns, stats.parse_ns);
+  add(global.serialize_ns, stats.serialize_ns);
+}
+
+StatsScope::StatsScope(Stats &stats) : stats(stats), outer(current_scope) {
+  current_scope = this;
+}
+
+StatsScope::~StatsScope() {
+  current_scope = outer;
+}
+
+Stats global_stats() {
+  Stats result;
+  result.bytes_parsed = global.bytes_parsed.load(std::memory_order_relaxed);
+  result.bytes_serialized = global.bytes_serialized.load(std::memory_order_relaxed);
+  for (int i = 0; i < Stats::kTypes; ++i) {
+    result.nodes[i] = global.nodes[i].load(std::memory_order_relaxed);
+  }
+  result.allocations = global.allocations.load(std::memory_order_relaxed);
+  result.bytes_allocated = global.bytes_allocated.load(std::memory_order_relaxed);
+  result.max_depth = global.max_depth.load(std::memory_order_relaxed);
+  result.prepass_ns = global.prepass_ns.load(std::memory_order_relaxed);
+  result.parse_ns = global.parse_ns.load(std::memory_order_relaxed);
+  result.serialize_ns = global.serialize_ns.load(std::memory_order_relaxed);
+  return result;
+}
+
+void reset_global_stats() {
+  global.bytes_parsed = 0;
+  global.bytes_serialized = 0;
+  for (int i = 0; i < Stats::kTypes; ++i) {
+    global.nodes[i] = 0;
+  }
+  global.allocations = 0;
+  global.bytes_allocated = 0;
+  global.max_depth = 0;
+  global.prepass_ns = 0;
+  global.parse_ns = 0;
+  global.serialize_ns = 0;
+}
+
+StatsTimer::StatsTimer(std::uint64_t Stats::*phase) : phase(phase), start(now_ns()) {
+  ++timer_depth;
+}
+
+StatsTimer::~StatsTimer() {
+  Stats &stats = pending_stats();
+  stats.*phase += now_ns() - start;
+  if (--timer_depth == 0) {
+    publish_stats(stats);
+    stats.clear();
+  }
+}
+
+}
@@ -0,0 +1,137 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JSTP_CPP_JSRS_STATS_H
+#define JSTP_CPP_JSRS_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Counting is compiled in only if JSTP_CPP_STATS is defined, see the JSRS_ENABLE_STATS option.
+// Otherwise the hooks are empty and all the counters stay zero.
+#ifdef JSTP_CPP_STATS
+#define JSTP_CPP_COUNT(statement) statement
+#define JSTP_CPP_TIME(phase) ::jstp::StatsTimer stats_timer(&::jstp::Stats::phase)
+#else
+#define JSTP_CPP_COUNT(statement)
+#define JSTP_CPP_TIME(phase)
+#endif
+
+namespace jstp {
+
+/**
+ * Counters of parsing and serialization
+ *
+ * Phases are timed in nanoseconds: prepass is the check of the outermost level by the lazy parser,
+ * the search for brackets of the parallel parser and the structural index, parse is the lexer and
+ * serialize is stringify(). A lazy container parsed during serialization is counted in both of them.
+ */
+struct Stats {
+  static const int kTypes = 7;  // Number of Record::Type values
+
+  std::uint64_t bytes_parsed;
+  std::uint64_t bytes_serialized;
+  std::uint64_t nodes[kTypes];     // Records built by parsers, by Record::Type
+  std::uint64_t allocations;       // By Allocator and for strings of parsed Records
+  std::uint64_t bytes_allocated;
+  std::uint64_t max_depth;         // Of nesting of arrays and objects
+  std::uint64_t prepass_ns;
+  std::uint64_t parse_ns;
+  std::uint64_t serialize_ns;
+
+  Stats() { clear(); }
+
+  void clear();
+  // Sums the counters, max_depth is the larger one
+  Stats &operator+=(const Stats &other);
+};
+
+/**
+ * Collects the counters of the calls made by the current thread while it exists into stats,
+ * which is not cleared first. Scopes may nest, an outer one gets the counters of the inner ones too.
+ */
+class StatsScope {
+ public:
+  explicit StatsScope(Stats &stats);
+  ~StatsScope();
+
+  StatsScope(const StatsScope &) = delete;
+  StatsScope &operator=(const StatsScope &) = delete;
+
+ private:
+  friend void publish_stats(const Stats &stats);
+
+  Stats &stats;
+  StatsScope *const outer;
+};
+
+/**
+ * Returns the totals of all the threads since the start or the last reset
+ */
+Stats global_stats();
+void reset_global_stats();
+
+// Hooks of the library
+
+/**
+ * Counters of the current thread that are not published yet
+ */
+inline Stats &pending_stats() {
+  static thread_local Stats stats;
+  return stats;
+}
+
+inline void count_allocation(std::size_t bytes) {
+  Stats &stats = pending_stats();
+  ++stats.allocations;
+  stats.bytes_allocated += bytes;
+}
+
+inline void count_depth(std::size_t depth) {
+  Stats &stats = pending_stats();
+  if (depth > stats.max_depth) {
+    stats.max_depth = depth;
+  }
+}
+
+/**
+ * Adds its lifetime to a phase. The outermost timer of a thread publishes the pending counters
+ * to the current StatsScope and to the global totals when it is destroyed.
+ */
+class StatsTimer {
+ public:
+  explicit StatsTimer(std::uint64_t Stats::*phase);
+  ~StatsTimer();
+
+  StatsTimer(const StatsTimer &) = delete;
+  StatsTimer &operator=(const StatsTimer &) = delete;
+
+ private:
+  std::uint64_t Stats::*const phase;
+  const std::uint64_t start;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_STATS_H
@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_schema.h"
+#include "jsrs_stats.h"
+
+#include <thread>
+
+#ifdef JSTP_CPP_STATS
+
+TEST(jsrs_stats_test, jsrs_stats_test_Scope) {
+  const std::string input = "{a:1,b:[true,'x',null,{c:undefined}]}";
+  jstp::Stats stats;
+  std::string err;
+  {
+    jstp::StatsScope scope(stats);
+    jstp::Record record = jstp::Record::parse(input, err);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(record.stringify().size(), stats.bytes_serialized);
+  }
+  EXPECT_EQ(input.size(), stats.bytes_parsed);
+  EXPECT_EQ(2u, stats.nodes[jstp::Record::OBJECT]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::ARRAY]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::NUMBER]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::BOOL]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::STRING]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::NUL]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::UNDEFINED]);
+  EXPECT_EQ(3u, stats.max_depth);
+  EXPECT_LT(0u, stats.allocations);
+  EXPECT_LE(stats.allocations, stats.bytes_allocated);
+
+  jstp::Stats outer;
+  {
+    jstp::StatsScope outer_scope(outer);
+    jstp::Stats inner;
+    {
+      jstp::StatsScope inner_scope(inner);
+      jstp::Record::parse("[1,2]", err);
+    }
+    EXPECT_EQ(2u, inner.nodes[jstp::Record::NUMBER]);
+    jstp::Record::parse("[3]", err);
+  }
+  EXPECT_EQ(3u, outer.nodes[jstp::Record::NUMBER]);
+  EXPECT_EQ(8u, outer.bytes_parsed);
+
+  outer += stats;
+  EXPECT_EQ(3u, outer.max_depth);
+  EXPECT_EQ(4u, outer.nodes[jstp::Record::NUMBER]);
+  outer.clear();
+  EXPECT_EQ(0u, outer.bytes_parsed);
+}
+
+TEST(jsrs_stats_test, jsrs_stats_test_Phases) {
+  std::string input = "[{x:[0]}";
+  for (int i = 1; i < 100000; ++i) {
+    input += ",{x:[1]}";
+  }
+  input += "]";
+  jstp::Stats stats;
+  std::string err;
+  {
+    jstp::StatsScope scope(stats);
+    jstp::Record record = jstp::Record::parse_lazy(input, err);
+    EXPECT_EQ(0u, stats.bytes_parsed);
+    EXPECT_LT(0u, stats.prepass_ns);
+    EXPECT_EQ(100000u, record.array_items().size());
+    EXPECT_EQ(100000u, stats.nodes[jstp::Record::OBJECT]);
+    EXPECT_EQ(1u, stats.max_depth);
+  }
+  EXPECT_EQ(input.size(), stats.bytes_parsed);
+  EXPECT_LT(0u, stats.parse_ns);
+
+  stats.clear();
+  {
+    jstp::StatsScope scope(stats);
+    jstp::Record::parse_indexed(input, err);
+  }
+  EXPECT_LT(0u, stats.prepass_ns);
+  EXPECT_LT(0u, stats.parse_ns);
+  EXPECT_EQ(input.size(), stats.bytes_parsed);
+  EXPECT_EQ(3u, stats.max_depth);
+}
+
+TEST(jsrs_stats_test, jsrs_stats_test_Global) {
+  jstp::reset_global_stats();
+  std::thread thread([] {
+    std::string err;
+    jstp::Record::parse("[[[1]]]", err);
+  });
+  thread.join();
+  jstp::Stats stats = jstp::global_stats();
+  EXPECT_EQ(7u, stats.bytes_parsed);
+  EXPECT_EQ(3u, stats.nodes[jstp::Record::ARRAY]);
+  EXPECT_EQ(3u, stats.max_depth);
+  jstp::reset_global_stats();
+  EXPECT_EQ(0u, jstp::global_stats().bytes_parsed);
+}
+
+TEST(jsrs_stats_test, jsrs_stats_test_Schema) {
+  jstp::Schema schema;
+  std::string err;
+  ASSERT_TRUE(schema.compile("{a:'number',b:['string?'],c:{d:'boolean',e:'null'},f:'any'}", err));
+  const std::string input = "{a:1,b:['x',,undefined],c:{d:true,e:null},f:[2]}";
+  jstp::Stats stats;
+  {
+    jstp::StatsScope scope(stats);
+    schema.parse(input, err);
+    EXPECT_EQ("", err);
+  }
+  EXPECT_EQ(input.size(), stats.bytes_parsed);
+  EXPECT_EQ(2u, stats.nodes[jstp::Record::OBJECT]);
+  EXPECT_EQ(2u, stats.nodes[jstp::Record::ARRAY]);
+  EXPECT_EQ(2u, stats.nodes[jstp::Record::NUMBER]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::BOOL]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::STRING]);
+  EXPECT_EQ(1u, stats.nodes[jstp::Record::NUL]);
+  EXPECT_EQ(2u, stats.nodes[jstp::Record::UNDEFINED]);
+  EXPECT_EQ(2u, stats.max_depth);
+}
+
+#else
+
+TEST(jsrs_stats_test, jsrs_stats_test_Disabled) {
+  jstp::Stats stats;
+  std::string err;
+  {
+    jstp::StatsScope scope(stats);
+    jstp::Record::parse("{a:[1,2]}", err).stringify();
+  }
+  EXPECT_EQ(0u, stats.bytes_parsed);
+  EXPECT_EQ(0u, stats.nodes[jstp::Record::NUMBER]);
+  EXPECT_EQ(0u, jstp::global_stats().bytes_parsed);
+}
+
+#endif
@@ -0,0 +1,311 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_stream.h"
+#include "jsrs_number.h"
+#include "jsrs_scan.h"
+#include "jsrs_string.h"
+
+#include <cstring>
+
+namespace jstp {
+
+StreamParser::StreamParser() : StreamParser(nullptr) { }
+
+StreamParser::StreamParser(KeyPool *keys)
+    : state(kValue), comment_return(kValue), quote('\"'), escaped(false), keys(keys), depth(0) { }
+
+bool StreamParser::feed(const std::string &chunk, std::vector<Record> &out, std::string &err) {
+  return feed(chunk.data(), chunk.size(), out, err);
+}
+
+bool StreamParser::feed(const char *data, std::size_t length, std::vector<Record> &out, std::string &err) {
+  if (state == kError) {
+    return fail("Parser must be reset after an error", err);
+  }
+  const char *i = data;
+  const char *end = data + length;
+  while (i < end) {
+    const char c = *i;
+    Frame *top = depth ? frames[depth - 1].get() : nullptr;
+    // Whitespace and comments may appear between any tokens
+    if (state == kValue || state == kFirstItem || state == kAfterValue || state == kKey || state == kColon) {
+      if (is_space(c) || (c == '\0' && !top)) {
+        ++i;
+        continue;
+      }
+      if (c == '/') {
+        comment_return = state;
+        state = kCommentStart;
+        ++i;
+        continue;
+      }
+    }
+    switch (state) {
+      case kValue:
+      case kFirstItem:
+        if (c == ',' || c == ']') {
+          if (!top) {
+            return fail("Invalid type", err);
+          }
+          if (c == ']' && state == kFirstItem) { // In case of empty array
+            ++i;
+            close_frame(out);
+          } else { // Skipped array item or object value
+            complete(Record(), out);
+          }
+        } else if (c == '{') {
+          ++i;
+          push_frame(true);
+          state = kKey;
+        } else if (c == '[') {
+          ++i;
+          push_frame(false);
+          state = kFirstItem;
+        } else if (c == '\"' || c == '\'') {
+          ++i;
+          quote = c;
+          token.clear();
+          escaped = false;
+          state = kString;
+        } else if (c == 't' || c == 'f' || c == 'n' || c == 'u') {
+          token.clear();
+          state = kLiteral;
+        } else if (is_number_start(c)) {
+          token.clear();
+          state = kNumber;
+        } else {
+          return fail("Invalid type", err);
+        }
+        break;
+      case kAfterValue:
+        if (c == ',') {
+          ++i;
+          state = top->is_object ? kKey : kValue;
+        } else if (c == (top->is_object ? '}' : ']')) {
+          ++i;
+          close_frame(out);
+        } else {
+          return fail(top->is_object ? "Invalid format in object: missed semicolon"
+                                     : "Invalid format in array: missed semicolon", err);
+        }
+        break;
+      case kKey:
+        if (is_key_char(c)) {
+          top->key.clear();
+          state = kInKey;
+        } else if (c == '}') {
+          ++i;
+          close_frame(out);
+        } else {
+          return fail("Invalid format in object: key is invalid", err);
+        }
+        break;
+      case kInKey: {
+        const char *key_end = skip_key_chars(i, end);
+        top->key.append(i, key_end);
+        i = key_end;
+        if (i < end) {
+          state = kColon;
+        }
+        break;
+      }
+      case kColon:
+        if (c != ':') {
+          return fail("Invalid format in object: key is invalid", err);
+        }
+        ++i;
+        state = kValue;
+        break;
+      case kString: {
+        const char *string_end = find_string_stop(i, end, quote);
+        token.append(i, string_end);
+        i = string_end;
+        if (i < end) {
+          ++i;
+          if (*string_end == '\\') {
+            token += '\\';
+            escaped = true;
+            state = kStringEscape;
+          } else if (!escaped) {
+            complete(Record(std::move(token)), out);
+            token.clear();
+          } else {
+            const char *token_end = token.data() + token.size();
+            const char *j = static_cast<const char *>(std::memchr(token.data(), '\\', token.size()));
+            while (j) {
+              j = skip_escape(j, token_end);
+              if (!j) {
+                return fail("Invalid escape sequence in string", err);
+              }
+              j = static_cast<const char *>(std::memchr(j, '\\', token_end - j));
+            }
+            std::string decoded;
+            unescape(token.data(), token_end, decoded);
+            complete(Record(std::move(decoded)), out);
+            token.clear();
+          }
+        }
+        break;
+      }
+      case kStringEscape:
+        token += c;
+        ++i;
+        state = kString;
+        break;
+      case kNumber:
+        if (is_number_char(c)) {
+          token += c;
+          ++i;
+        } else {
+          double value;
+          if (parse_double(token.data(), token.data() + token.size(), value) != token.size()) {
+            return fail("Invalid format of number", err);
+          }
+          complete(Record(value), out);
+        }
+        break;
+      case kLiteral:
+        if (is_key_char(c)) {
+          if (token.size() == sizeof("undefined") - 1) {
+            return fail("Invalid format", err);
+          }
+          token += c;
+          ++i;
+        } else if (token == "true") {
+          complete(Record(true), out);
+        } else if (token == "false") {
+          complete(Record(false), out);
+        } else if (token == "null") {
+          complete(Record(nullptr), out);
+        } else if (token == "undefined") {
+          complete(Record(), out);
+        } else {
+          return fail("Invalid format", err);
+        }
+        break;
+      case kCommentStart:
+        if (c == '/') {
+          state = kLineComment;
+        } else if (c == '*') {
+          state = kBlockComment;
+        } else {
+          return fail("Invalid format", err);
+        }
+        ++i;
+        break;
+      case kLineComment:
+        if (c == '\n' || c == '\r') {
+          state = comment_return;
+        }
+        ++i;
+        break;
+      case kBlockComment:
+      case kBlockCommentStar:
+        if (c == '/' && state == kBlockCommentStar) {
+          state = comment_return;
+        } else {
+          state = (c == '*') ? kBlockCommentStar : kBlockComment;
+        }
+        ++i;
+        break;
+      case kError:
+        return false;
+    }
+  }
+  return true;
+}
+
+bool StreamParser::finish(std::vector<Record> &out, std::string &err) {
+  // The terminator completes a top level number or literal and is skipped afterwards
+  const char terminator = '\0';
+  if (!feed(&terminator, 1, out, err)) {
+    return false;
+  }
+  if (depth || (state != kValue && state != kLineComment)) {
+    return fail("Unexpected end of input", err);
+  }
+  reset();
+  return true;
+}
+
+void StreamParser::reset() {
+  state = kValue;
+  comment_return = kValue;
+  token.clear();
+  for (std::size_t i = 0; i < depth; ++i) {
+    Frame &frame = *frames[i];
+    frame.items.clear();
+    frame.values.clear();
+  }
+  depth = 0;
+}
+
+bool StreamParser::in_progress() const {
+  return depth || state == kString || state == kStringEscape || state == kNumber || state == kLiteral;
+}
+
+bool StreamParser::fail(const char *message, std::string &err) {
+  state = kError;
+  err = message;
+  return false;
+}
+
+void StreamParser::push_frame(bool is_object) {
+  if (depth == frames.size()) {
+    frames.emplace_back(new Frame());
+  }
+  Frame &frame = *frames[depth++];
+  frame.is_object = is_object;
+}
+
+void StreamParser::close_frame(std::vector<Record> &out) {
+  Frame &frame = *frames[--depth];
+  Record value;
+  if (frame.is_object) {
+    value = Record(std::move(frame.values));
+    frame.values.clear();
+  } else {
+    value = Record(std::move(frame.items));
+    frame.items.clear();
+  }
+  complete(std::move(value), out);
+}
+
+void StreamParser::complete(Record &&value, std::vector<Record> &out) {
+  if (!depth) {
+    out.push_back(std::move(value));
+    state = kValue;
+    return;
+  }
+  Frame &top = *frames[depth - 1];
+  state = kAfterValue;
+  if (!top.is_object) {
+    top.items.push_back(std::move(value));
+    return;
+  }
+  top.values[keys ? keys->intern(top.key) : Key(top.key)] = std::move(value); // Later duplicates win, as in JS
+}
+
+}
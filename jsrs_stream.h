@@ -0,0 +1,112 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef JSTP_CPP_JSRS_STREAM_H
+#define JSTP_CPP_JSRS_STREAM_H
+
+#include "jsrs.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace jstp {
+
+/**
+ * Incremental parser of a stream of Records
+ *
+ * Input may be split into chunks at any byte, the parser keeps its state between calls
+ * and returns every Record as soon as it is complete. Top level records are separated
+ * by whitespace, comments or '\0' packet terminators.
+ */
+class StreamParser {
+ public:
+  StreamParser();
+
+  /**
+   * Parser that takes keys of objects from keys, the pool must outlive the parser
+   */
+  explicit StreamParser(KeyPool *keys);
+
+  /**
+   * Consumes a chunk of input and appends records completed by it to out.
+   * Returns false and sets err if the input is malformed, the parser must be reset then.
+   */
+  bool feed(const char *data, std::size_t length, std::vector<Record> &out, std::string &err);
+  bool feed(const std::string &chunk, std::vector<Record> &out, std::string &err);
+
+  /**
+   * Signals the end of input: completes a pending top level number or literal
+   * and fails if a record is unfinished. The parser is ready for a new stream afterwards.
+   */
+  bool finish(std::vector<Record> &out, std::string &err);
+
+  /**
+   * Drops any partially parsed record and clears an error
+   */
+  void reset();
+
+  /**
+   * Returns true if a record has been started but is not complete yet
+   */
+  bool in_progress() const;
+
+ private:
+  enum State {
+    kValue, kFirstItem, kAfterValue, kKey, kInKey, kColon,
+    kString, kStringEscape, kNumber, kLiteral,
+    kCommentStart, kLineComment, kBlockComment, kBlockCommentStar, kError
+  };
+
+  /**
+   * Array or object that is being parsed
+   */
+  struct Frame {
+    bool is_object;
+    Record::array items;
+    Record::object values;
+    std::string key;
+  };
+
+  bool fail(const char *message, std::string &err);
+  void push_frame(bool is_object);
+  void close_frame(std::vector<Record> &out);
+  void complete(Record &&value, std::vector<Record> &out);
+
+  State state;
+  State comment_return;
+  char quote;
+  // The string being parsed contains escape sequences
+  bool escaped;
+  KeyPool *keys;
+  std::string token;
+  // Frames are kept between records so that the frames and the buffers of their keys are reused,
+  // the items and values move into the records. Only the first depth are in use
+  std::vector<std::unique_ptr<Frame>> frames;
+  std::size_t depth;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_STREAM_H
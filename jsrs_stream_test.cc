@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_stream.h"
+
+TEST(jsrs_stream_test, jsrs_stream_test_ByteByByte) {
+  std::vector<std::string> arr = testData::validArray();
+  for (auto &iterator : arr) {
+    std::string err = "";
+    jstp::Record expected = jstp::Record::parse(iterator, err);
+    jstp::StreamParser parser;
+    std::vector<jstp::Record> records;
+    for (std::size_t i = 0; i < iterator.size(); ++i) {
+      EXPECT_TRUE(parser.feed(iterator.data() + i, 1, records, err)) << err;
+    }
+    EXPECT_TRUE(parser.finish(records, err)) << err;
+    ASSERT_EQ(1, records.size());
+    EXPECT_EQ(expected.stringify(), records[0].stringify());
+  }
+}
+
+TEST(jsrs_stream_test, jsrs_stream_test_Packets) {
+  std::string stream = std::string("{a:1,b:'x'}") + '\0' + "[1, /* c */ 2]" + '\0' + "42" + '\0' + " true";
+  std::string err = "";
+  jstp::StreamParser parser;
+  std::vector<jstp::Record> records;
+  EXPECT_TRUE(parser.feed(stream.substr(0, 7), records, err));
+  EXPECT_EQ(0, records.size());
+  EXPECT_TRUE(parser.in_progress());
+  EXPECT_TRUE(parser.feed(stream.substr(7), records, err));
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ("{a:1,b:\"x\"}", records[0].stringify());
+  EXPECT_EQ("[1,2]", records[1].stringify());
+  EXPECT_EQ(42, records[2].number_value());
+  EXPECT_TRUE(parser.finish(records, err));
+  ASSERT_EQ(4, records.size());
+  EXPECT_TRUE(records[3].bool_value());
+}
+
+TEST(jsrs_stream_test, jsrs_stream_test_Errors) {
+  std::vector<std::string> arr = testData::inValidArray();
+  for (auto &iterator : arr) {
+    std::string err = "";
+    jstp::StreamParser parser;
+    std::vector<jstp::Record> records;
+    bool result = parser.feed(iterator, records, err) && parser.finish(records, err);
+    EXPECT_FALSE(result);
+    EXPECT_NE("", err);
+  }
+  std::string err = "";
+  jstp::StreamParser parser;
+  std::vector<jstp::Record> records;
+  EXPECT_TRUE(parser.feed("{a:[1,", records, err));
+  EXPECT_FALSE(parser.finish(records, err));
+}
+
+TEST(jsrs_stream_test, jsrs_stream_test_KeyPool) {
+  std::string err = "";
+  jstp::KeyPool keys;
+  jstp::StreamParser parser(&keys);
+  std::vector<jstp::Record> records;
+  EXPECT_TRUE(parser.feed("{id:1,name:'a'}\0{name:'b',id:2}\0", 32, records, err));
+  ASSERT_EQ(2, records.size());
+  EXPECT_EQ(2, keys.size());
+  EXPECT_TRUE(records[0].object_items().begin()->first.same((records[1].object_items().begin() + 1)->first));
+  EXPECT_EQ(2, records[1]["id"].number_value());
+}
+
+TEST(jsrs_stream_test, jsrs_stream_test_Escapes) {
+  std::string stream = "['a\\'b', \"\\u20AC\\n\"] 'bad\\u12'";
+  std::string err = "";
+  jstp::StreamParser parser;
+  std::vector<jstp::Record> records;
+  for (std::size_t i = 0; i < stream.size() && err.empty(); ++i) {
+    parser.feed(stream.data() + i, 1, records, err);
+  }
+  ASSERT_EQ(1, records.size());
+  EXPECT_EQ("a'b", records[0][0].string_value());
+  EXPECT_EQ("\xE2\x82\xAC\n", records[0][1].string_value());
+  EXPECT_EQ("Invalid escape sequence in string", err);
+}
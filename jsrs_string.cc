@@ -0,0 +1,202 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_string.h"
+
+#include <cstring>
+
+namespace jstp {
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// Parses count hex digits at begin, returns -1 if there are not enough of them
+static long parse_hex(const char *begin, const char *end, std::size_t count) {
+  if (static_cast<std::size_t>(end - begin) < count) {
+    return -1;
+  }
+  long result = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    int digit = hex_digit(begin[i]);
+    if (digit < 0) {
+      return -1;
+    }
+    result = result * 16 + digit;
+  }
+  return result;
+}
+
+// Parses \u{...} starting after the 'u', returns -1 if it is malformed
+static long parse_braced_code_point(const char *begin, const char *end, const char *&next) {
+  const char *i = begin + 1;
+  long result = 0;
+  while (i < end && *i != '}') {
+    int digit = hex_digit(*i);
+    if (digit < 0) {
+      return -1;
+    }
+    result = result * 16 + digit;
+    if (result > 0x10FFFF) {
+      return -1;
+    }
+    ++i;
+  }
+  if (i >= end || i == begin + 1) {
+    return -1;
+  }
+  next = i + 1;
+  return result;
+}
+
+static void append_utf8(unsigned long code_point, std::string &out) {
+  if (code_point < 0x80) {
+    out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    out += static_cast<char>(0xC0 | (code_point >> 6));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    out += static_cast<char>(0xE0 | (code_point >> 12));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (code_point >> 18));
+    out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
+
+const char *skip_escape(const char *begin, const char *end) {
+  if (end - begin < 2) {
+    return nullptr;
+  }
+  const char *next = begin + 2;
+  switch (begin[1]) {
+    case 'x':
+      return parse_hex(next, end, 2) < 0 ? nullptr : next + 2;
+    case 'u':
+      if (next < end && *next == '{') {
+        return parse_braced_code_point(next, end, next) < 0 ? nullptr : next;
+      }
+      return parse_hex(next, end, 4) < 0 ? nullptr : next + 4;
+    case '\r':
+      return (next < end && *next == '\n') ? next + 1 : next;
+    default:
+      return next;
+  }
+}
+
+void unescape(const char *begin, const char *end, std::string &out) {
+  const char *i = begin;
+  while (i < end) {
+    const char *backslash = static_cast<const char *>(std::memchr(i, '\\', end - i));
+    if (!backslash) {
+      out.append(i, end);
+      break;
+    }
+    out.append(i, backslash);
+    i = backslash + 2;
+    switch (backslash[1]) {
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'v': out += '\v'; break;
+      case '0': out += '\0'; break;
+      case '\n': break;  // Line continuation
+      case '\r':
+        if (i < end && *i == '\n') {
+          ++i;
+        }
+        break;
+      case 'x':
+        append_utf8(static_cast<unsigned long>(parse_hex(i, end, 2)), out);
+        i += 2;
+        break;
+      case 'u': {
+        long code_point;
+        if (*i == '{') {
+          code_point = parse_braced_code_point(i, end, i);
+        } else {
+          code_point = parse_hex(i, end, 4);
+          i += 4;
+          // Surrogate pair written as two escape sequences
+          if (code_point >= 0xD800 && code_point < 0xDC00 && end - i >= 6 && i[0] == '\\' && i[1] == 'u') {
+            long low = parse_hex(i + 2, end, 4);
+            if (low >= 0xDC00 && low < 0xE000) {
+              code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+              i += 6;
+            }
+          }
+        }
+        append_utf8(static_cast<unsigned long>(code_point), out);
+        break;
+      }
+      default:  // Any other character stands for itself
+        out += backslash[1];
+    }
+  }
+}
+
+void append_quoted(const char *data, std::size_t length, std::string &out) {
+  static const char kHex[] = "0123456789abcdef";
+  out += '\"';
+  const char *end = data + length;
+  const char *run = data;
+  for (const char *i = data; i < end; ++i) {
+    const unsigned char c = static_cast<unsigned char>(*i);
+    if (c >= 0x20 && c != '\"' && c != '\\') {
+      continue;
+    }
+    out.append(run, i);
+    run = i + 1;
+    out += '\\';
+    switch (c) {
+      case '\"': out += '\"'; break;
+      case '\\': out += '\\'; break;
+      case '\b': out += 'b'; break;
+      case '\f': out += 'f'; break;
+      case '\n': out += 'n'; break;
+      case '\r': out += 'r'; break;
+      case '\t': out += 't'; break;
+      default:
+        out += "u00";
+        out += kHex[c >> 4];
+        out += kHex[c & 0xF];
+    }
+  }
+  out.append(run, end);
+  out += '\"';
+}
+
+}
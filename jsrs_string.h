@@ -0,0 +1,55 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+// Escape sequences of strings, not a part of the public interface
+
+#ifndef JSTP_CPP_JSRS_STRING_H
+#define JSTP_CPP_JSRS_STRING_H
+
+#include <cstddef>
+#include <string>
+
+namespace jstp {
+
+/**
+ * Skips an escape sequence that starts with the backslash at begin and returns
+ * a pointer past it, or nullptr if the sequence is malformed or is cut by end
+ */
+const char *skip_escape(const char *begin, const char *end);
+
+/**
+ * Appends characters of a string with escape sequences decoded to out. Code points are
+ * written in UTF-8, the sequences must have been checked with skip_escape().
+ */
+void unescape(const char *begin, const char *end, std::string &out);
+
+/**
+ * Appends a string enclosed in double quotes to out, escaping quotes, backslashes
+ * and control characters
+ */
+void append_quoted(const char *data, std::size_t length, std::string &out);
+
+}
+
+#endif //JSTP_CPP_JSRS_STRING_H
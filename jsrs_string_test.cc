@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "jsrs.h"
+#include "jsrs_string.h"
+
+#include <string>
+
+static std::string unescape(const std::string &str) {
+  std::string result;
+  jstp::unescape(str.data(), str.data() + str.size(), result);
+  return result;
+}
+
+static bool is_valid(const std::string &escape) {
+  return jstp::skip_escape(escape.data(), escape.data() + escape.size()) == escape.data() + escape.size();
+}
+
+TEST(jsrs_string_test, jsrs_string_test_Unescape) {
+  EXPECT_EQ("plain", unescape("plain"));
+  EXPECT_EQ("a\"b'c\\d/", unescape("a\\\"b\\'c\\\\d\\/"));
+  EXPECT_EQ("\b\f\n\r\t\v", unescape("\\b\\f\\n\\r\\t\\v"));
+  EXPECT_EQ(std::string("a\0b", 3), unescape("a\\0b"));
+  EXPECT_EQ("ab", unescape("a\\\nb"));
+  EXPECT_EQ("ab", unescape("a\\\r\nb"));
+  EXPECT_EQ("A\xC3\xA9", unescape("\\x41\\xe9"));
+  EXPECT_EQ("\xE2\x82\xAC", unescape("\\u20AC"));
+  EXPECT_EQ("\xF0\x9F\x98\x80", unescape("\\uD83D\\uDE00"));
+  EXPECT_EQ("\xF0\x9F\x98\x80", unescape("\\u{1F600}"));
+  EXPECT_EQ("q", unescape("\\q"));
+}
+
+TEST(jsrs_string_test, jsrs_string_test_SkipEscape) {
+  EXPECT_TRUE(is_valid("\\n"));
+  EXPECT_TRUE(is_valid("\\x7f"));
+  EXPECT_TRUE(is_valid("\\uABCD"));
+  EXPECT_TRUE(is_valid("\\u{10FFFF}"));
+  EXPECT_TRUE(is_valid("\\\r\n"));
+  EXPECT_FALSE(is_valid("\\"));
+  EXPECT_FALSE(is_valid("\\x7"));
+  EXPECT_FALSE(is_valid("\\xg0"));
+  EXPECT_FALSE(is_valid("\\u12"));
+  EXPECT_FALSE(is_valid("\\u{}"));
+  EXPECT_FALSE(is_valid("\\u{110000}"));
+  EXPECT_FALSE(is_valid("\\u{12"));
+
+  std::string err = "";
+  jstp::Record::parse("'\\x4'", err);
+  EXPECT_NE("", err);
+}
+
+TEST(jsrs_string_test, jsrs_string_test_Quote) {
+  std::string out;
+  jstp::append_quoted("say \"hi\"\\\n\x01", 11, out);
+  EXPECT_EQ("\"say \\\"hi\\\"\\\\\\n\\u0001\"", out);
+
+  std::string err = "";
+  jstp::Record jsrs = jstp::Record::parse("['it\\'s', \"tab\\tand \\\"quote\\\"\"]", err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ("it's", jsrs[0].string_value());
+  EXPECT_EQ("[\"it's\",\"tab\\tand \\\"quote\\\"\"]", jsrs.stringify());
+  EXPECT_EQ(jsrs, jstp::Record::parse(jsrs.stringify(), err));
+}
@@ -0,0 +1,211 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "jsrs_tape.h"
+#include "jsrs_index.h"
+
+namespace jstp {
+
+/**
+ * Handler of IndexReader that appends values to the entries of a tape
+ */
+class TapeBuilder {
+ public:
+  explicit TapeBuilder(std::vector<Tape::Entry> &entries) : entries(entries) { }
+
+  bool on_undefined() {
+    add(Record::UNDEFINED);
+    return true;
+  }
+
+  bool on_null() {
+    add(Record::NUL);
+    return true;
+  }
+
+  bool on_bool(bool value) {
+    add(Record::BOOL).boolean = value;
+    return true;
+  }
+
+  bool on_number(double value) {
+    add(Record::NUMBER).number = value;
+    return true;
+  }
+
+  bool on_string(const char *data, std::size_t length, bool escaped) {
+    Tape::Entry &entry = add(Record::STRING);
+    entry.string = StringRef(data, length);
+    entry.escaped = escaped;
+    return true;
+  }
+
+  bool on_object_begin() {
+    open.push_back(entries.size());
+    add(Record::OBJECT);
+    return true;
+  }
+
+  bool on_key(StringRef value) {
+    key = value;
+    return true;
+  }
+
+  bool on_object_end() { return close(); }
+
+  bool on_array_begin() {
+    open.push_back(entries.size());
+    add(Record::ARRAY);
+    return true;
+  }
+
+  bool on_array_end() { return close(); }
+
+ private:
+  Tape::Entry &add(Record::Type type) {
+    entries.emplace_back();
+    Tape::Entry &entry = entries.back();
+    entry.type = type;
+    entry.escaped = false;
+    entry.key = key;
+    entry.next = 0;
+    key = StringRef();
+    return entry;
+  }
+
+  bool close() {
+    entries[open.back()].next = entries.size();
+    open.pop_back();
+    return true;
+  }
+
+  std::vector<Tape::Entry> &entries;
+  // Positions of the containers that are not finished yet
+  std::vector<std::size_t> open;
+  // Key of the next value
+  StringRef key;
+};
+
+/**
+ * Reports the entry at position and its contents to a handler of Reader,
+ * returns the position of the entry that follows them
+ */
+template <class Handler>
+std::size_t replay(const std::vector<Tape::Entry> &entries, std::size_t position, Handler &handler) {
+  const Tape::Entry &entry = entries[position];
+  switch (entry.type) {
+    case Record::UNDEFINED:
+      handler.on_undefined();
+      break;
+    case Record::NUL:
+      handler.on_null();
+      break;
+    case Record::BOOL:
+      handler.on_bool(entry.boolean);
+      break;
+    case Record::NUMBER:
+      handler.on_number(entry.number);
+      break;
+    case Record::STRING:
+      handler.on_string(entry.string.data(), entry.string.size(), entry.escaped);
+      break;
+    case Record::ARRAY:
+      handler.on_array_begin();
+      for (std::size_t i = position + 1; i < entry.next;) {
+        i = replay(entries, i, handler);
+      }
+      handler.on_array_end();
+      return entry.next;
+    case Record::OBJECT:
+      handler.on_object_begin();
+      for (std::size_t i = position + 1; i < entry.next;) {
+        handler.on_key(entries[i].key);
+        i = replay(entries, i, handler);
+      }
+      handler.on_object_end();
+      return entry.next;
+  }
+  return position + 1;
+}
+
+Tape::Tape(Tape &&other) : entries(std::move(other.entries)) {
+  const char *old_input = other.input.data();
+  input = std::move(other.input);
+  rebase(old_input);
+  other.entries.clear();
+}
+
+Tape &Tape::operator=(Tape &&other) {
+  if (this != &other) {
+    entries = std::move(other.entries);
+    const char *old_input = other.input.data();
+    input = std::move(other.input);
+    rebase(old_input);
+    other.entries.clear();
+  }
+  return *this;
+}
+
+void Tape::rebase(const char *old_input) {
+  if (old_input == input.data()) {  // The buffer was moved, not copied as a short string is
+    return;
+  }
+  for (auto &entry : entries) {
+    if (entry.key.data()) {
+      entry.key = StringRef(input.data() + (entry.key.data() - old_input), entry.key.size());
+    }
+    if (entry.type == Record::STRING) {
+      entry.string = StringRef(input.data() + (entry.string.data() - old_input), entry.string.size());
+    }
+  }
+}
+
+bool Tape::parse(std::string in, std::string &err) {
+  input = std::move(in);
+  entries.clear();
+  TapeBuilder builder(entries);
+  const char *error = read_indexed(input.data(), input.data() + input.size(), builder);
+  if (error) {
+    err = error;
+    entries.clear();
+    return false;
+  }
+  return true;
+}
+
+std::size_t Tape::skip(std::size_t position) const {
+  const Entry &entry = entries[position];
+  return (entry.type == Record::ARRAY || entry.type == Record::OBJECT) ? entry.next : position + 1;
+}
+
+Record Tape::record(std::size_t position) const {
+  if (position >= entries.size()) {
+    return Record();
+  }
+  RecordBuilder builder(nullptr, nullptr, false);
+  replay(entries, position, builder);
+  return builder.result();
+}
+
+}
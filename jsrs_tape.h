@@ -0,0 +1,92 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmytro Nechai, Nikolai Belochub
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JSTP_CPP_JSRS_TAPE_H
+#define JSTP_CPP_JSRS_TAPE_H
+
+#include "jsrs.h"
+
+#include <string>
+#include <vector>
+
+namespace jstp {
+
+/**
+ * Flat form of a parsed Record for large inputs
+ *
+ * Values are laid out in document order, every array or object is followed by its contents
+ * and knows the position past them, so it is skipped at once. The tape keeps the input,
+ * strings and keys refer to it and are decoded only when a Record is built. A tape may be moved
+ * but not copied.
+ */
+class Tape {
+ public:
+  struct Entry {
+    Record::Type type;
+    bool escaped;       // The string has escape sequences
+    StringRef key;      // Of a value of an object, empty otherwise
+    StringRef string;   // As it is in the input, without quotes
+    union {
+      bool boolean;
+      double number;
+      std::size_t next; // Position of the entry that follows an array or an object with its contents
+    };
+  };
+
+  Tape() { }
+  Tape(Tape &&other);
+  Tape &operator=(Tape &&other);
+
+  Tape(const Tape &) = delete;
+  Tape &operator=(const Tape &) = delete;
+
+  /**
+   * Parses in with the two-stage parser, returns false and sets err if it is malformed
+   */
+  bool parse(std::string in, std::string &err);
+
+  std::size_t size() const { return entries.size(); }
+  const Entry &operator[](std::size_t position) const { return entries[position]; }
+
+  /**
+   * Returns the position of the entry that follows the one at position and its contents
+   */
+  std::size_t skip(std::size_t position) const;
+
+  /**
+   * Builds a Record of the entry at position and its contents
+   */
+  Record record(std::size_t position = 0) const;
+
+ private:
+  // Moves keys and strings of the entries to input, they referred to the same offsets of old_input
+  void rebase(const char *old_input);
+
+  std::string input;
+  std::vector<Entry> entries;
+};
+
+}
+
+#endif //JSTP_CPP_JSRS_TAPE_H
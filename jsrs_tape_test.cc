@@ -0,0 +1,63 @@
+#include "gtest/gtest.h"
+#include "deps.h"
+#include "jsrs_tape.h"
+
+#include <memory>
+#include <type_traits>
+
+TEST(jsrs_tape_test, jsrs_tape_test_Layout) {
+  jstp::Tape tape;
+  std::string err = "";
+  ASSERT_TRUE(tape.parse("{a:[1,{b:'x\\ty'}],c:true,d:null,e:undefined}", err));
+  EXPECT_EQ("", err);
+  ASSERT_EQ(8, tape.size());
+  EXPECT_EQ(jstp::Record::OBJECT, tape[0].type);
+  EXPECT_EQ(8, tape.skip(0));
+  EXPECT_EQ(jstp::Record::ARRAY, tape[1].type);
+  EXPECT_EQ("a", tape[1].key.str());
+  EXPECT_EQ(5, tape.skip(1));
+  EXPECT_EQ(1, tape[2].number);
+  EXPECT_EQ(5, tape.skip(3));
+  EXPECT_EQ("x\\ty", tape[4].string.str());
+  EXPECT_TRUE(tape[4].escaped);
+  EXPECT_EQ("c", tape[5].key.str());
+  EXPECT_TRUE(tape[5].boolean);
+  EXPECT_EQ(jstp::Record::NUL, tape[6].type);
+  EXPECT_EQ(jstp::Record::UNDEFINED, tape[7].type);
+  EXPECT_EQ(8, tape.skip(7));
+}
+
+TEST(jsrs_tape_test, jsrs_tape_test_Records) {
+  jstp::Tape tape;
+  std::string err = "";
+  const std::string in = "{a:[1,{b:'x\\ty'}],c:true,d:null,e:undefined}";
+  ASSERT_TRUE(tape.parse(in, err));
+  EXPECT_EQ(jstp::Record::parse(in, err), tape.record());
+  EXPECT_EQ("{b:\"x\\ty\"}", tape.record(3).stringify());
+  EXPECT_EQ("[1,{b:\"x\\ty\"}]", tape.record(1).stringify());
+
+  EXPECT_FALSE(tape.parse("{a:[1,2}", err));
+  EXPECT_NE("", err);
+  EXPECT_EQ(0, tape.size());
+  EXPECT_TRUE(tape.record().is_undefined());
+}
+
+TEST(jsrs_tape_test, jsrs_tape_test_Move) {
+  std::string err = "";
+  const std::string in = "{a:'x',b:[1]}";  // Short enough to be kept in the string object
+  jstp::Record expected = jstp::Record::parse(in, err);
+  std::unique_ptr<jstp::Tape> source(new jstp::Tape());
+  ASSERT_TRUE(source->parse(in, err));
+  jstp::Tape moved(std::move(*source));
+  source.reset();
+  EXPECT_EQ(expected, moved.record());
+  EXPECT_EQ("a", moved[1].key.str());
+
+  jstp::Tape assigned;
+  ASSERT_TRUE(assigned.parse("[" + std::string(100, '1') + "]", err));
+  assigned = std::move(moved);
+  EXPECT_EQ(expected, assigned.record());
+  EXPECT_EQ("x", assigned[1].string.str());
+  EXPECT_FALSE(std::is_copy_constructible<jstp::Tape>::value);
+  EXPECT_FALSE(std::is_copy_assignable<jstp::Tape>::value);
+}
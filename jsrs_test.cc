@@ -1,5 +1,10 @@
 #include "gtest/gtest.h"
 #include "deps.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
 
 int checksum(std::string s){
   int result = 0;
@@ -92,3 +97,356 @@ TEST(jsrs_test, jsrs_test_dump_TestShouldNotWork) {
     EXPECT_NE("", err);
   }
 }
+
+TEST(jsrs_test, jsrs_test_parse_TestComments) {
+  std::string err = "";
+  jstp::Record jsrs = jstp::Record::parse("// leading comment\n"
+                                              "{ /* key */ name : 'Marcus', // trailing\n"
+                                              "  list : [ 1 , /* two */ 2 ]\n"
+                                              "} /* end */", err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ("{name:\"Marcus\",list:[1,2]}", jsrs.stringify());
+}
+
+TEST(jsrs_test, jsrs_test_parse_TestTrailingData) {
+  std::string err = "";
+  jstp::Record::parse("{a:1} {b:2}", err);
+  EXPECT_NE("", err);
+  err = "";
+  jstp::Record::parse("[1, 2", err);
+  EXPECT_NE("", err);
+  err = "";
+  jstp::Record::parse("{a:\"unterminated}", err);
+  EXPECT_NE("", err);
+}
+
+TEST(jsrs_test, jsrs_test_parse_TestLongTokens) {
+  for (std::size_t padding = 0; padding < 40; ++padding) {
+    std::string spaces(padding, ' ');
+    std::string key = "key_" + std::string(padding, 'k');
+    std::string value = std::string(padding, 'v') + "\\\"" + std::string(padding, 'w');
+    std::string decoded = std::string(padding, 'v') + "\"" + std::string(padding, 'w');
+    std::string in = spaces + "{" + spaces + key + spaces + ":" + spaces + "\"" + value + "\"" + spaces
+        + ",\n" + spaces + "q:'" + value + "\"'" + spaces + "}" + spaces;
+    std::string err = "";
+    jstp::Record jsrs = jstp::Record::parse(in, err);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(decoded, jsrs[key].string_value());
+    EXPECT_EQ(decoded + "\"", jsrs["q"].string_value());
+  }
+}
+
+TEST(jsrs_test, jsrs_test_scalars_TestInline) {
+  jstp::Record number(25.5);
+  jstp::Record boolean(true);
+  EXPECT_TRUE(number.is_number());
+  EXPECT_EQ(25.5, number.number_value());
+  EXPECT_EQ(0.0, boolean.number_value());
+  EXPECT_TRUE(boolean.bool_value());
+  EXPECT_FALSE(number.bool_value());
+  EXPECT_EQ("", number.string_value());
+  EXPECT_EQ(0, number.array_items().size());
+  EXPECT_TRUE(number["key"].is_undefined());
+  EXPECT_EQ(jstp::Record(25.5), number);
+  EXPECT_NE(jstp::Record(25.5), jstp::Record(true));
+  EXPECT_NE(jstp::Record(nullptr), jstp::Record());
+  EXPECT_LT(jstp::Record(1.0), jstp::Record(2.0));
+  EXPECT_LT(jstp::Record(false), jstp::Record(true));
+  EXPECT_GE(jstp::Record(2.0), jstp::Record(2.0));
+}
+
+TEST(jsrs_test, jsrs_test_dump_TestAppend) {
+  std::string err = "";
+  jstp::Record jsrs = jstp::Record::parse("{b:[1,,-20.25,'x'],a:{c:null,d:undefined}}", err);
+  EXPECT_EQ("", err);
+  std::string buffer = "prefix:";
+  jsrs.stringify(buffer);
+  EXPECT_EQ("prefix:{b:[1,,-20.25,\"x\"],a:{c:null,d:undefined}}", buffer);
+  buffer.clear();
+  jstp::Record(1e21).stringify(buffer);
+  jstp::Record(-123456.0).stringify(buffer);
+  EXPECT_EQ("1e+21-123456", buffer);
+  buffer.clear();
+  for (double value : {std::nan(""), HUGE_VAL, -HUGE_VAL, 1e300}) {  // Sized without conversion to integer
+    jstp::Record(value).stringify(buffer);
+    buffer += ',';
+  }
+  EXPECT_EQ("NaN,Infinity,-Infinity,1e+300,", buffer);
+}
+
+TEST(jsrs_test, jsrs_test_parse_TestObjectOrder) {
+  std::string err = "";
+  jstp::Record jsrs = jstp::Record::parse("{z:1,a:2,m:3,a:4}", err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ(3, jsrs.object_items().size());
+  EXPECT_EQ("{z:1,a:4,m:3}", jsrs.stringify());
+  EXPECT_EQ(4.0, jsrs["a"].number_value());
+  EXPECT_TRUE(jsrs["b"].is_undefined());
+  EXPECT_EQ(jstp::Record::parse("{m:3,a:4,z:1}", err), jsrs);
+  EXPECT_NE(jstp::Record::parse("{m:3,a:4,y:1}", err), jsrs);
+}
+
+TEST(jsrs_test, jsrs_test_parse_TestWideObject) {
+  std::string in = "{";
+  for (int i = 0; i < 500; ++i) {
+    in += "key" + std::to_string(i) + ":" + std::to_string(i) + ",";
+  }
+  in += "key7:-7}";
+  std::string err = "";
+  jstp::Record jsrs = jstp::Record::parse(in, err);
+  EXPECT_EQ("", err);
+  const jstp::Record::object &items = jsrs.object_items();
+  EXPECT_EQ(500, items.size());
+  EXPECT_EQ("key0", items.begin()->first);
+  EXPECT_EQ("key499", (items.end() - 1)->first);
+  for (int i = 0; i < 500; ++i) {
+    EXPECT_EQ(i == 7 ? -7.0 : i, jsrs["key" + std::to_string(i)].number_value());
+  }
+  EXPECT_TRUE(jsrs["key500"].is_undefined());
+  EXPECT_EQ(0, items.count("key"));
+
+  jstp::Record::object copy = items;
+  EXPECT_EQ(1, copy.count("key499"));
+  copy["key500"] = jstp::Record(true);
+  EXPECT_TRUE(copy.at("key500").bool_value());
+  EXPECT_FALSE(copy.insert(std::make_pair(std::string("key1"), jstp::Record())).second);
+  EXPECT_EQ(jsrs, jstp::Record(jsrs.object_items()));
+  EXPECT_NE(jsrs, jstp::Record(copy));
+}
+
+TEST(jsrs_test, jsrs_test_parse_TestKeyPool) {
+  std::string err = "";
+  jstp::Record first, second;
+  {
+    jstp::KeyPool keys(3);
+    first = jstp::Record::parse("{name:'a',phone:1,address:{name:'b'}}", err, keys);
+    EXPECT_EQ("", err);
+    second = jstp::Record::parse("{phone:2,name:'c',city:'d'}", err, keys);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(3, keys.size());
+  }
+  const jstp::Key &name = first.object_items().begin()->first;
+  EXPECT_TRUE(name.is_pooled());
+  EXPECT_TRUE(name.same((second.object_items().begin() + 1)->first));
+  EXPECT_TRUE(name.same(first["address"].object_items().begin()->first));
+  EXPECT_FALSE((second.object_items().begin() + 2)->first.is_pooled());
+  EXPECT_EQ("city", (second.object_items().begin() + 2)->first);
+  EXPECT_EQ("{phone:2,name:\"c\",city:\"d\"}", second.stringify());
+  EXPECT_EQ("c", second["name"].string_value());
+  EXPECT_EQ(jstp::Record::parse("{name:'a',phone:1,address:{name:'b'}}", err), first);
+}
+
+TEST(jsrs_test, jsrs_test_parse_TestLazy) {
+  for (auto &iterator : testData::validArray()) {
+    std::string err = "";
+    jstp::Record expected = jstp::Record::parse(iterator, err);
+    jstp::Record jsrs = jstp::Record::parse_lazy(iterator, err);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(expected.type(), jsrs.type());
+    EXPECT_EQ(expected, jsrs);
+    EXPECT_EQ(expected.stringify(), jsrs.stringify());
+  }
+
+  std::string err = "";
+  jstp::Record jsrs = jstp::Record::parse_lazy(
+      "{id:42, route:{to:'b', via:['x', 'y]']}, body:{text:'}{', /* ] */ broken:[1,,:]}, tail:[1]}", err);
+  EXPECT_EQ("", err);
+  EXPECT_TRUE(jsrs.is_object());
+  EXPECT_EQ(42, jsrs["id"].number_value());
+  EXPECT_TRUE(jsrs["route"].is_object());
+  EXPECT_EQ("y]", jsrs["route"]["via"][1].string_value());
+  EXPECT_EQ("}{", jsrs["body"]["text"].string_value());
+  EXPECT_TRUE(jsrs["body"]["broken"].is_array());
+  EXPECT_THROW(jsrs["body"]["broken"].array_items(), std::domain_error);
+  EXPECT_THROW(jsrs["body"]["broken"][0], std::domain_error);  // Failures are not cached as empty
+  EXPECT_EQ(1, jsrs["tail"][0].number_value());
+
+  jstp::Record::parse_lazy("{a:[1,2}", err);
+  EXPECT_NE("", err);
+  err = "";
+  jstp::Record::parse_lazy("{a:'}'", err);
+  EXPECT_NE("", err);
+  err = "";
+  jstp::Record::parse_lazy("[1] 2", err);
+  EXPECT_NE("", err);
+  for (const char *malformed : {"[1 2]", "{a 1}", "[truex]", "[-]", "[1e]", "[0x10]", "[Infinity]", "{a:[1],b}"}) {
+    err = "";
+    jstp::Record::parse_lazy(malformed, err);
+    EXPECT_NE("", err) << malformed;
+  }
+  err = "";
+  jsrs = jstp::Record::parse_lazy("{a:1,b:{c:[1 2]},d:[[truex]]}", err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ(1, jsrs["a"].number_value());
+  EXPECT_THROW(jsrs["b"]["c"][0], std::domain_error);
+  EXPECT_TRUE(jsrs["d"].is_array());
+  EXPECT_THROW(jsrs["d"][0][0], std::domain_error);
+  EXPECT_THROW(jsrs.stringify(), std::domain_error);
+  err = "";
+  EXPECT_EQ(jstp::Record(25.5), jstp::Record::parse_lazy(" 25.5 ", err));
+  EXPECT_EQ("", err);
+}
+
+TEST(jsrs_test, jsrs_test_parse_TestIndexed) {
+  for (auto &iterator : testData::validArray()) {
+    std::string err = "";
+    jstp::Record expected = jstp::Record::parse(iterator, err);
+    jstp::Record jsrs = jstp::Record::parse_indexed(iterator, err);
+    EXPECT_EQ("", err);
+    EXPECT_EQ(expected.stringify(), jsrs.stringify());
+  }
+  for (auto &iterator : testData::inValidArray()) {
+    std::string err = "";
+    jstp::Record::parse_indexed(iterator, err);
+    EXPECT_NE("", err) << iterator;
+  }
+
+  std::string err = "";
+  jstp::Record jsrs = jstp::Record::parse_indexed(
+      "{a:'x\\n]', /* b:[ */ c:[1,,true,null,undefined,'}'],d:{e:\"\\u0041\"},f:-2.5e3}", err);
+  EXPECT_EQ("", err);
+  EXPECT_EQ("{a:\"x\\n]\",c:[1,,true,null,,\"}\"],d:{e:\"A\"},f:-2500}", jsrs.stringify());
+  std::string in = "[";
+  for (int i = 0; i < 50; ++i) {
+    in += "{key" + std::to_string(i) + ":'" + std::string(i, 'x') + "\\t]', /* " + std::string(i % 7, '}') +
+          " */ n:" + std::to_string(i) + ",q:\"'\"},";
+  }
+  in += "]";
+  EXPECT_EQ(jstp::Record::parse(in, err).stringify(), jstp::Record::parse_indexed(in, err).stringify());
+  EXPECT_EQ("", err);
+  for (const char *iterator : {"{a:1,b}", "[1 2]", "{'a':1}", "[1] 2", "['\\x']", "[1/2]", "{a:[1,2}"}) {
+    jstp::Record::parse_indexed(iterator, err = "");
+    EXPECT_NE("", err) << iterator;
+  }
+}
+
+TEST(jsrs_test, jsrs_test_edit_TestMutation) {
+  std::string err = "";
+  jstp::Record original = jstp::Record::parse("{id:1,tags:['a'],meta:{seen:false}}", err);
+  EXPECT_EQ("", err);
+
+  // Shared contents are copied on the first change
+  jstp::Record copy = original;
+  copy.set("trace", "x-1");
+  copy.set("id", 2.0);
+  EXPECT_TRUE(copy.erase("meta"));
+  EXPECT_FALSE(copy.erase("missing"));
+  EXPECT_TRUE(copy.emplace("extra", true));
+  EXPECT_FALSE(copy.emplace("extra", false));
+  EXPECT_EQ("{id:2,tags:[\"a\"],trace:\"x-1\",extra:true}", copy.stringify());
+  EXPECT_EQ("{id:1,tags:[\"a\"],meta:{seen:false}}", original.stringify());
+
+  // Unshared contents are changed in place
+  jstp::Record tags;
+  tags.push_back("b");
+  tags.emplace_back(3.0);
+  EXPECT_EQ("[\"b\",3]", tags.stringify());
+  jstp::Record moved = std::move(tags);
+  const jstp::Record::array *items = &moved.array_items();
+  moved.push_back(nullptr);
+  EXPECT_EQ(items, &moved.array_items());
+  EXPECT_TRUE(moved.erase(std::size_t(0)));
+  EXPECT_FALSE(moved.erase(std::size_t(5)));
+  EXPECT_EQ("[3,null]", moved.stringify());
+
+  jstp::Record number(1.0);
+  EXPECT_THROW(number.push_back(1.0), std::domain_error);
+  EXPECT_THROW(number.set("a", 1.0), std::domain_error);
+  EXPECT_FALSE(number.erase("a"));
+
+  // Large objects keep their index in sync
+  jstp::Record wide;
+  for (int i = 0; i < 40; ++i) {
+    wide.set("k" + std::to_string(i), static_cast<double>(i));
+  }
+  EXPECT_TRUE(wide.erase("k3"));
+  EXPECT_TRUE(wide["k3"].is_undefined());
+  EXPECT_EQ(39, wide["k39"].number_value());
+  EXPECT_EQ(39, wide.object_items().size());
+
+  jstp::Record lazy = jstp::Record::parse_lazy("{a:[1,2],b:{}}", err);
+  lazy.set("c", 3.0);
+  EXPECT_EQ("{a:[1,2],b:{},c:3}", lazy.stringify());
+}
+
+TEST(jsrs_test, jsrs_test_compare_TestOrder) {
+  std::string err = "";
+  std::vector<jstp::Record> records;
+  for (const char *iterator : {"{b:1,a:2}", "[1,2]", "'b'", "[1]", "null", "[1,[3]]", "{a:1}",
+                               "2", "'a'", "{a:2,c:0}", "undefined", "true", "[1,[2,5]]", "-1"}) {
+    records.push_back(jstp::Record::parse(iterator, err));
+    EXPECT_EQ("", err);
+  }
+  std::sort(records.begin(), records.end());
+  std::string sorted;
+  for (auto &record : records) {
+    sorted += record.stringify() + " ";
+  }
+  EXPECT_EQ("undefined null true -1 2 \"a\" \"b\" [1] [1,2] [1,[2,5]] [1,[3]] {a:1} {b:1,a:2} {a:2,c:0} ",
+            sorted);
+
+  jstp::Record lhs = jstp::Record::parse("{b:[1,'x'],a:{c:null}}", err);
+  jstp::Record rhs = jstp::Record::parse("{a:{c:null},b:[1,'x']}", err);
+  EXPECT_EQ(0, lhs.compare(rhs));
+  EXPECT_TRUE(lhs <= rhs && lhs >= rhs && !(lhs < rhs) && !(lhs > rhs));
+  EXPECT_LT(jstp::Record(-1.0), jstp::Record(std::nan("")));
+  EXPECT_EQ(0, jstp::Record(std::nan("")).compare(jstp::Record(std::nan(""))));
+  EXPECT_LT(jstp::Record(1.0), jstp::Record("1"));
+  EXPECT_GT(jstp::Record::parse_lazy("[1,[3]]", err), jstp::Record::parse("[1,[2]]", err));
+}
+
+TEST(jsrs_test, jsrs_test_compare_TestHash) {
+  std::string err = "";
+  jstp::Record lhs = jstp::Record::parse("{b:[1,'x'],a:{c:null,d:-0}}", err);
+  jstp::Record rhs = jstp::Record::parse_lazy("{a:{d:0,c:null},b:[1,\"x\"]}", err);
+  jstp::Record other = jstp::Record::parse("{b:[1,'y'],a:{c:null,d:0}}", err);
+  EXPECT_EQ(lhs, rhs);
+  EXPECT_EQ(lhs.hash(), rhs.hash());
+  EXPECT_NE(lhs.hash(), other.hash());
+  EXPECT_NE(jstp::Record(1.0).hash(), jstp::Record("1").hash());
+  EXPECT_NE(jstp::Record().hash(), jstp::Record(nullptr).hash());
+  EXPECT_NE(jstp::Record::parse("[1,2]", err).hash(), jstp::Record::parse("[2,1]", err).hash());
+
+  // Cached hashes are reset by changes
+  std::size_t before = lhs.hash();
+  lhs.set("e", true);
+  EXPECT_NE(before, lhs.hash());
+  EXPECT_TRUE(lhs.erase("e"));
+  EXPECT_EQ(before, lhs.hash());
+
+  std::unordered_map<jstp::Record, int> counts;
+  for (const char *iterator : {"{a:1,b:2}", "{b:2,a:1}", "[1]", "{a:1}", "[1]"}) {
+    ++counts[jstp::Record::parse(iterator, err)];
+  }
+  EXPECT_EQ(3, counts.size());
+  EXPECT_EQ(2, counts[jstp::Record::parse("{a:1,b:2}", err)]);
+  EXPECT_EQ(2, counts[jstp::Record::parse("[1]", err)]);
+}
+
+TEST(jsrs_test, jsrs_test_compare_TestNaN) {
+  // NaN is equal to NaN for ==, compare() and hash() alike
+  const jstp::Record nan(std::nan(""));
+  const jstp::Record negative_nan(-std::nan("1"));
+  EXPECT_TRUE(nan == nan);
+  EXPECT_FALSE(nan != negative_nan);
+  EXPECT_TRUE(nan <= nan && nan >= nan);
+  EXPECT_EQ(nan.hash(), negative_nan.hash());
+  EXPECT_NE(nan, jstp::Record(1.0));
+  std::string err = "";
+  jstp::Record lhs = jstp::Record::parse("{a:[1,NaN],b:NaN}", err);
+  jstp::Record rhs = jstp::Record::parse_lazy("{b:NaN,a:[1,NaN]}", err);
+  EXPECT_EQ(lhs, rhs);
+  EXPECT_EQ(0, lhs.compare(rhs));
+  EXPECT_EQ(lhs.hash(), rhs.hash());
+
+  std::unordered_map<jstp::Record, int> hashed;
+  std::map<jstp::Record, int> ordered;
+  for (const jstp::Record &key : {nan, negative_nan, lhs, rhs}) {
+    ++hashed[key];
+    ++ordered[key];
+  }
+  EXPECT_EQ(2, hashed.size());
+  EXPECT_EQ(2, ordered.size());
+  EXPECT_EQ(2, hashed[nan]);
+  EXPECT_EQ(2, ordered[lhs]);
+}